@@ -5,11 +5,17 @@
 #include "ast/ASTKindProperty.h"
 #include "ast/ASTPrinter.h"
 #include "ast/ASTWalker.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/iterator.h"
+#include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/SMLoc.h"
 
 namespace ast {
 class ASTBuilder;
+class ASTChildIterator;
+class ASTPreOrderIterator;
+class ASTPostOrderIterator;
 class Visitor;
 
 class ASTImpl {
@@ -18,13 +24,56 @@ public:
 
   llvm::SMRange getLoc() const { return range; }
 
+  ASTContext *getContext() const { return context; }
+
+  /// Change tracking state, kept by the owning context while it tracks
+  /// changes. A node is dirty if it was mutated in place and subtree-dirty if
+  /// it or one of its descendants was.
+  bool isDirty() const { return context && context->isDirty(index); }
+  bool isSubtreeDirty() const {
+    return context && context->isSubtreeDirty(index);
+  }
+
+  /// Subtree summary, kept by the owning context while it computes
+  /// summaries. Shared subtrees count once per occurrence.
+  bool hasSummary() const { return getSummary().subtreeSize != 0; }
+  /// Number of nodes in the subtree, saturating.
+  std::uint32_t getSubtreeSize() const { return getSummary().subtreeSize; }
+  /// Longest path to a leaf, zero for a leaf, saturating.
+  std::uint16_t getHeight() const { return getSummary().height; }
+  /// Union of the kind masks of the strict descendants.
+  std::uint64_t getDescendantKindMask() const {
+    return getSummary().descendantKindMask;
+  }
+
+  /// Dense index among the nodes created in the owning context, below
+  /// ASTContext::getNumNodeIndices().
+  std::uint32_t getIndex() const { return index; }
+
+protected:
+  void markModified() {
+    if (context && context->isObservingMutations())
+      context->markModified(this);
+  }
+
 private:
   friend class ::ast::ASTBuilder;
+  friend class ::ast::ASTContext;
   void setProperty(ASTKindProperty *property) { this->property = property; }
   void setLocation(llvm::SMRange range) { this->range = range; }
+  void setContext(ASTContext *context) {
+    this->context = context;
+    index = context->numNodeIndices++;
+  }
+
+  ASTContext::NodeSummary getSummary() const {
+    return context ? context->getSummary(index) : ASTContext::NodeSummary{};
+  }
 
   ASTKindProperty *property{nullptr};
   llvm::SMRange range;
+  ASTContext *context{nullptr};
+  std::uint32_t index{0};
 };
 
 class AST {
@@ -60,8 +109,79 @@ public:
     getASTKindProperty().getChildrenWalkFn()(*this, std::forward<Fn>(fn));
   }
 
+  /// Children in traversal order, including null ones. Kinds with fixed
+  /// children are served from their offset table, the others by their kind.
+  std::size_t getNumChildren() const {
+    const auto &property = getASTKindProperty();
+    if (property.hasFixedChildren())
+      return property.getChildOffsets().size();
+    return property.getNumChildrenFn()(*this);
+  }
+
+  /// Takes linear time in `idx` for kinds that are neither served by an
+  /// offset table nor by generated child access; use children() or nextChild
+  /// to step through all children.
+  AST getChild(std::size_t idx) const {
+    const auto &property = getASTKindProperty();
+    if (property.hasFixedChildren()) {
+      assert(idx < property.getChildOffsets().size() && "Invalid child index");
+      return *getChildSlot(property.getChildOffsets()[idx]);
+    }
+    return property.getChildFn()(*this, idx);
+  }
+
+  void setChild(std::size_t idx, AST child) const;
+
+  /// Stores the child at `cursor` in `child`, which may be null, and moves the
+  /// cursor past it. Returns false after the last child. A step only searches
+  /// the member, or the container element, the cursor is at, so stepping
+  /// through all children takes linear time.
+  bool nextChild(detail::ChildCursor &cursor, AST &child) const {
+    const auto &property = getASTKindProperty();
+    if (property.hasFixedChildren()) {
+      auto offsets = property.getChildOffsets();
+      if (cursor.member == offsets.size())
+        return false;
+      child = *getChildSlot(offsets[cursor.member++]);
+      return true;
+    }
+    return property.getNextChildFn()(*this, cursor, child);
+  }
+
+  /// Children in traversal order, including null ones.
+  llvm::iterator_range<ASTChildIterator> children() const;
+  /// This AST and its descendants, parents before children. Null children
+  /// are skipped and shared subtrees are visited once per occurrence.
+  llvm::iterator_range<ASTPreOrderIterator> preOrder() const;
+  /// This AST and its descendants, children before parents.
+  llvm::iterator_range<ASTPostOrderIterator> postOrder() const;
+
   bool isEqual(const AST other) const {
-    return getASTKindProperty().getEqualFn()(*this, other);
+    if (impl == other.impl)
+      return true;
+    if (!impl || !other.impl)
+      return false;
+    return getASTKindProperty().getEqualFn()(
+        *this, other, [](AST lhs, AST rhs) { return lhs.isEqual(rhs); });
+  }
+
+  /// Like isEqual, but remembers the pairs of subtrees found equal, so that
+  /// each pair is compared once. Use it for trees sharing subtrees, which
+  /// isEqual compares once per occurrence.
+  bool isEqualMemoized(const AST other) const;
+
+  /// Structural hash: equal ASTs hash alike, whichever context they live in.
+  /// Shared subtrees are hashed once.
+  llvm::hash_code hash() const;
+
+  /// Deep copy this AST into `ctx`, preserving sharing between subtrees. The
+  /// copy is laid out in pre-order, so cloning a tree into a fresh context
+  /// compacts it; see ASTCloner.
+  AST clone(ASTContext *ctx) const;
+
+  /// Replace each child `c` of this AST with `fn(c)` in place.
+  void remapChildren(const std::function<AST(AST)> &fn) const {
+    getASTKindProperty().getRemapChildrenFn()(*this, fn);
   }
 
   std::string toString() const;
@@ -77,12 +197,201 @@ public:
     return walker.Walk(*this);
   }
 
+  /// Walk the ASTs of the given kinds only, calling `fn` with each of them
+  /// cast to its kind. Subtrees that cannot contain any of the kinds are not
+  /// entered.
+  template <typename Kind, typename... Kinds, typename Fn>
+  WalkResult walk(Fn &&fn, WalkOrder order = WalkOrder::PostOrder) const {
+    ASTWalker walker(order);
+    walker.setKindFilter({ID::get<Kind>(), ID::get<Kinds>()...});
+    walker.addFn([&fn](AST ast) {
+      WalkResult result;
+      ID id = ast.getID();
+      auto visit = [&]<typename K>() {
+        if (id != ID::get<K>())
+          return false;
+        if constexpr (std::is_void_v<std::invoke_result_t<Fn &, K>>)
+          fn(ast.cast<K>());
+        else
+          result = fn(ast.cast<K>());
+        return true;
+      };
+      (visit.template operator()<Kind>() || ... ||
+       visit.template operator()<Kinds>());
+      return result;
+    });
+    return walker.Walk(*this);
+  }
+
   llvm::SMRange getLoc() const { return impl->getLoc(); }
+  ASTContext *getContext() const { return impl->getContext(); }
+  std::uint32_t getIndex() const { return impl->getIndex(); }
+  bool isDirty() const { return impl->isDirty(); }
+  bool isSubtreeDirty() const { return impl->isSubtreeDirty(); }
+  bool hasSummary() const { return impl->hasSummary(); }
+  std::uint32_t getSubtreeSize() const { return impl->getSubtreeSize(); }
+  std::uint16_t getHeight() const { return impl->getHeight(); }
+  std::uint64_t getDescendantKindMask() const {
+    return impl->getDescendantKindMask();
+  }
 
 private:
+  friend class ::ast::ASTBuilder;
+
+  AST *getChildSlot(std::uint32_t offset) const {
+    return reinterpret_cast<AST *>(reinterpret_cast<char *>(impl) + offset);
+  }
+
   ASTImpl *impl;
 };
 
+/// Iterates the children of an AST with a cursor into its members, without
+/// allocating. A default-constructed iterator is the end of any children.
+class ASTChildIterator
+    : public llvm::iterator_facade_base<ASTChildIterator,
+                                        std::forward_iterator_tag, AST,
+                                        std::ptrdiff_t, AST *, AST> {
+public:
+  ASTChildIterator() = default;
+  explicit ASTChildIterator(AST parent) : parent(parent) { load(); }
+
+  AST operator*() const { return child; }
+  ASTChildIterator &operator++() {
+    ++idx;
+    load();
+    return *this;
+  }
+  bool operator==(const ASTChildIterator &other) const {
+    return parent == other.parent && idx == other.idx;
+  }
+
+private:
+  void load() {
+    if (!parent.nextChild(cursor, child))
+      *this = ASTChildIterator();
+  }
+
+  AST parent;
+  detail::ChildCursor cursor;
+  AST child;
+  std::size_t idx = 0;
+};
+
+namespace detail {
+/// A node being traversed by a descendant iterator and its next child.
+struct ASTTraversalFrame {
+  AST node;
+  ChildCursor cursor;
+  /// Children stepped past so far.
+  std::size_t next = 0;
+  bool done = false;
+
+  explicit ASTTraversalFrame(AST node) : node(node) {}
+
+  /// Returns the next non-null child, or null if there is none.
+  AST nextChild() {
+    AST child;
+    while (!done) {
+      if (!node.nextChild(cursor, child)) {
+        done = true;
+        break;
+      }
+      ++next;
+      if (child)
+        return child;
+    }
+    return {};
+  }
+};
+} // namespace detail
+
+/// Pre-order iterator over a tree, driven by an explicit stack.
+class ASTPreOrderIterator
+    : public llvm::iterator_facade_base<ASTPreOrderIterator,
+                                        std::forward_iterator_tag, AST,
+                                        std::ptrdiff_t, AST *, AST> {
+public:
+  ASTPreOrderIterator() = default;
+  explicit ASTPreOrderIterator(AST root) {
+    if (root)
+      stack.emplace_back(root);
+  }
+
+  AST operator*() const { return stack.back().node; }
+  ASTPreOrderIterator &operator++() {
+    while (!stack.empty()) {
+      if (AST child = stack.back().nextChild()) {
+        stack.emplace_back(child);
+        return *this;
+      }
+      stack.pop_back();
+    }
+    return *this;
+  }
+  bool operator==(const ASTPreOrderIterator &other) const {
+    if (stack.size() != other.stack.size())
+      return false;
+    return stack.empty() || (stack.back().node == other.stack.back().node &&
+                             stack.back().next == other.stack.back().next &&
+                             stack.back().done == other.stack.back().done);
+  }
+
+  /// Do not visit the descendants of the current AST.
+  void skipChildren() { stack.back().done = true; }
+
+private:
+  llvm::SmallVector<detail::ASTTraversalFrame, 8> stack;
+};
+
+/// Post-order iterator over a tree, driven by an explicit stack.
+class ASTPostOrderIterator
+    : public llvm::iterator_facade_base<ASTPostOrderIterator,
+                                        std::forward_iterator_tag, AST,
+                                        std::ptrdiff_t, AST *, AST> {
+public:
+  ASTPostOrderIterator() = default;
+  explicit ASTPostOrderIterator(AST root) {
+    if (root) {
+      stack.emplace_back(root);
+      descend();
+    }
+  }
+
+  AST operator*() const { return stack.back().node; }
+  ASTPostOrderIterator &operator++() {
+    stack.pop_back();
+    if (!stack.empty())
+      descend();
+    return *this;
+  }
+  bool operator==(const ASTPostOrderIterator &other) const {
+    if (stack.size() != other.stack.size())
+      return false;
+    return stack.empty() || (stack.back().node == other.stack.back().node &&
+                             stack.back().next == other.stack.back().next &&
+                             stack.back().done == other.stack.back().done);
+  }
+
+private:
+  /// Push the leftmost unvisited path below the top of the stack.
+  void descend() {
+    while (AST child = stack.back().nextChild())
+      stack.emplace_back(child);
+  }
+
+  llvm::SmallVector<detail::ASTTraversalFrame, 8> stack;
+};
+
+inline llvm::iterator_range<ASTChildIterator> AST::children() const {
+  return {ASTChildIterator(*this), ASTChildIterator()};
+}
+inline llvm::iterator_range<ASTPreOrderIterator> AST::preOrder() const {
+  return {ASTPreOrderIterator(*this), ASTPreOrderIterator()};
+}
+inline llvm::iterator_range<ASTPostOrderIterator> AST::postOrder() const {
+  return {ASTPostOrderIterator(*this), ASTPostOrderIterator()};
+}
+
 inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const AST &ast) {
   ast.print(os);
   return os;
@@ -30,6 +30,10 @@ public:
                                             std::forward<Args>(args)...);
   }
 
+  ConcreteType clone(ASTContext *ctx) const {
+    return BaseType::clone(ctx).template cast<ConcreteType>();
+  }
+
   template <typename T>
     requires std::is_convertible_v<T, AST>
   static bool classof(const T ast) {
@@ -37,8 +41,10 @@ public:
   }
 
   static const auto getChildrenWalkFn() {
-    return [](BaseType ast, std::function<void(AST)> fn) {
-      if constexpr (HasTraversalOrder<ConcreteType>) {
+    return [](BaseType ast, llvm::function_ref<void(AST)> fn) {
+      if constexpr (HasGeneratedWalk<ConcreteType>) {
+        ConcreteType::walkASTMembers(ast.template cast<ConcreteType>(), fn);
+      } else if constexpr (HasTraversalOrder<ConcreteType>) {
         auto concreteAST = ast.template cast<ConcreteType>();
         const auto &traversalData = concreteAST.traversalOrder();
         detail::ASTDataHandler<
@@ -48,31 +54,105 @@ public:
     };
   }
 
+  static const auto getNumChildrenFn() {
+    return [](BaseType ast) -> std::size_t {
+      if constexpr (HasGeneratedChildAccess<ConcreteType>) {
+        return ConcreteType::getNumASTChildren(
+            ast.template cast<ConcreteType>());
+      } else {
+        std::size_t count = 0;
+        getChildrenWalkFn()(ast, [&count](BaseType) { ++count; });
+        return count;
+      }
+    };
+  }
+
+  static const auto getChildFn() {
+    return [](BaseType ast, std::size_t idx) -> BaseType {
+      if constexpr (HasGeneratedChildAccess<ConcreteType>) {
+        return ConcreteType::getASTChild(ast.template cast<ConcreteType>(),
+                                         idx);
+      } else {
+        detail::ChildCursor cursor;
+        BaseType child;
+        for (std::size_t count = 0; count <= idx; ++count) {
+          [[maybe_unused]] bool found = getNextChildFn()(ast, cursor, child);
+          assert(found && "Invalid child index");
+        }
+        return child;
+      }
+    };
+  }
+
+  static const auto getNextChildFn() {
+    return [](BaseType ast, detail::ChildCursor &cursor,
+              BaseType &child) -> bool {
+      if constexpr (HasTraversalOrder<ConcreteType>) {
+        auto concreteAST = ast.template cast<ConcreteType>();
+        const auto &traversalData = concreteAST.traversalOrder();
+        return detail::nextChild(traversalData, cursor, child);
+      }
+      return false;
+    };
+  }
+
   static const auto getEqualFn() {
-    return [](BaseType left, BaseType right) {
+    return [](BaseType left, BaseType right,
+              const detail::ChildEqualFn &childEqual) {
       if (left.getID() != right.getID())
         return false;
       assert(left.getID() == ID::get<ConcreteType>() &&
              "Expected both ASTs to be the concrete type of AST");
-      if constexpr (HasTraversalOrder<ConcreteType>) {
+      if constexpr (HasGeneratedEqual<ConcreteType>) {
+        return ConcreteType::isEqualASTMembers(
+            left.template cast<ConcreteType>(),
+            right.template cast<ConcreteType>(), childEqual);
+      } else if constexpr (HasTraversalOrder<ConcreteType>) {
         auto leftConcrete = left.template cast<ConcreteType>();
-        auto leftMember = leftConcrete.traversalOrder();
+        const auto &leftMember = leftConcrete.traversalOrder();
         auto rightConcrete = right.template cast<ConcreteType>();
-        auto rightMember = rightConcrete.traversalOrder();
-        return detail::ASTDataHandler<
-            std::remove_cvref_t<decltype(leftMember)>>::isEqual(leftMember,
-                                                                rightMember);
+        const auto &rightMember = rightConcrete.traversalOrder();
+        return detail::ASTDataHandler<std::remove_cvref_t<
+            decltype(leftMember)>>::isEqual(leftMember, rightMember,
+                                            childEqual);
       }
       return true;
     };
   }
 
+  static const auto getHashFn() {
+    return [](BaseType ast,
+              const detail::ChildHashFn &childHash) -> llvm::hash_code {
+      if constexpr (HasTraversalOrder<ConcreteType>) {
+        auto concreteAST = ast.template cast<ConcreteType>();
+        const auto &traversalData = concreteAST.traversalOrder();
+        return llvm::hash_combine(
+            ID::get<ConcreteType>(),
+            detail::ASTDataHandler<std::remove_cvref_t<
+                decltype(traversalData)>>::hash(traversalData, childHash));
+      }
+      return hash_value(ID::get<ConcreteType>());
+    };
+  }
+
   static const auto getPrintFn() {
     return [](BaseType ast, ASTPrinter &printer) {
       ConcreteType::print(ast.template cast<ConcreteType>(), printer);
     };
   }
 
+  static const auto getCloneFn() {
+    return [](BaseType ast, ASTCloner &cloner) -> BaseType {
+      return ASTBuilder::clone(ast.template cast<ConcreteType>(), cloner);
+    };
+  }
+
+  static const auto getRemapChildrenFn() {
+    return [](BaseType ast, const std::function<AST(AST)> &fn) {
+      ASTBuilder::remapChildren(ast.template cast<ConcreteType>(), fn);
+    };
+  }
+
 private:
 };
 
@@ -1,7 +1,10 @@
 #ifndef AST_BUILDER_H
 #define AST_BUILDER_H
 
+#include "ast/ASTCloner.h"
+#include "ast/ASTConcept.h"
 #include "ast/ASTContext.h"
+#include "ast/ASTDataHandler.h"
 #include "llvm/Support/SMLoc.h"
 
 namespace ast {
@@ -22,10 +25,86 @@ struct ASTBuilder {
     }
     impl->setProperty(kindProperty);
     impl->setLocation(range);
+    impl->setContext(ctx);
+    assert(hasAllowedChildren(impl) &&
+           "Child kind not allowed by the ASTTypeOf bounds of its parent");
+    if (ctx->isRecordingParents())
+      recordParents(ctx, Class(impl));
+    if (ctx->isComputingSummaries())
+      summarize(impl);
+    if (ctx->isCheckingRegions())
+      ctx->recordNode(impl);
 
     return Class(impl);
   }
 
+  template <typename Class>
+  static Class clone(Class ast, ASTCloner &cloner) {
+    using ImplTy = typename Class::ImplTy;
+
+    ASTContext *ctx = cloner.getContext();
+    auto *kindProperty = ctx->GetASTKindProperty(ID::get<Class>());
+    assert(kindProperty && "AST kind property not registered");
+
+    ImplTy *impl = cloner.isMoving()
+                       ? ctx->Alloc<ImplTy>(std::move(*ast.getImpl()))
+                       : ctx->Alloc<ImplTy>(*ast.getImpl());
+    impl->setProperty(kindProperty);
+    impl->setContext(ctx);
+
+    if constexpr (HasMutableTraversalOrder<ImplTy>) {
+      auto &&members = impl->traversalOrder();
+      detail::ASTDataHandler<std::remove_cvref_t<decltype(members)>>::remap(
+          members, [&cloner](auto child) { return cloner.cloneNode(child); });
+    }
+
+    if (ctx->isRecordingParents())
+      recordParents(ctx, Class(impl));
+    if (ctx->isComputingSummaries())
+      summarize(impl);
+    if (ctx->isCheckingRegions())
+      ctx->recordNode(impl);
+
+    return Class(impl);
+  }
+
+  /// Replace each child `c` of `ast` with `fn(c)` in place.
+  template <typename Class>
+  static void remapChildren(Class ast, const std::function<AST(AST)> &fn) {
+    using ImplTy = typename Class::ImplTy;
+
+    if constexpr (HasMutableTraversalOrder<ImplTy>) {
+      ImplTy *impl = ast.getImpl();
+      ASTContext *ctx = impl->getContext();
+      bool recordingParents = ctx && ctx->isRecordingParents();
+      llvm::SmallVector<ASTImpl *> oldChildren;
+      if (recordingParents)
+        ast.walkChildren([&oldChildren](auto child) {
+          if (child)
+            oldChildren.push_back(child.getImpl());
+        });
+
+      auto &&members = impl->traversalOrder();
+      detail::ASTDataHandler<std::remove_cvref_t<decltype(members)>>::remap(
+          members, fn);
+      markModified(impl);
+      assert(hasAllowedChildren(impl) &&
+             "Child kind not allowed by the ASTTypeOf bounds of its parent");
+
+      if (recordingParents)
+        updateParents(impl, oldChildren);
+      refreshSummaries(impl);
+    }
+  }
+
+  /// Replace the child at `idx` of `ast` in place.
+  static void setChild(AST ast, std::size_t idx, AST child);
+
+  /// Compute the subtree summary of `impl` from those of its children.
+  /// Returns true if it changed. A child without a summary, or from another
+  /// context, leaves `impl` without one.
+  static bool summarize(ASTImpl *impl);
+
   template <typename... Class> static void registerAST(ASTContext *ctx) {
     (ctx->RegisterAST(ID::get<Class>(), ASTKindProperty::get<Class>()), ...);
   }
@@ -34,6 +113,25 @@ struct ASTBuilder {
   static ASTKindProperty *getASTKindProperty(ASTContext *ctx) {
     return ctx->GetASTKindProperty(ID::get<Class>());
   }
+
+private:
+  /// False if a child of `impl` has a kind that cannot occur below the kind
+  /// of `impl`, see ASTKindProperty::mayContain.
+  static bool hasAllowedChildren(ASTImpl *impl);
+  static void markModified(ASTImpl *impl);
+  static void refreshSummaries(ASTImpl *impl);
+
+  /// Record `impl` as the parent of its current children and drop it from
+  /// the parents of `oldChildren` that are no longer among them.
+  static void updateParents(ASTImpl *impl,
+                            llvm::ArrayRef<ASTImpl *> oldChildren);
+
+  template <typename Class>
+  static void recordParents(ASTContext *ctx, Class ast) {
+    ast.walkChildren([ctx, parent = ast.getImpl()](auto child) {
+      ctx->recordParent(child.getImpl(), parent);
+    });
+  }
 };
 
 } // namespace ast
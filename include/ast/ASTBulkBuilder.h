@@ -0,0 +1,66 @@
+#ifndef AST_BULK_BUILDER_H
+#define AST_BULK_BUILDER_H
+
+#include "ast/AST.h"
+#include "ast/ASTContext.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/SMLoc.h"
+
+namespace ast {
+
+/// Builds a tree whose node counts are known up front in one contiguous
+/// arena block.
+///
+///   ASTBulkBuilder builder(ctx);
+///   builder.expect<Integer>(2).expect<Add>(1).Reserve();
+///   auto lhs = builder.create<Integer>(loc, 1);
+///   auto rhs = builder.create<Integer>(loc, 2);
+///   auto add = builder.create<Add>(loc, lhs, rhs);
+///
+/// Nodes are laid out in creation order. Since children are created before
+/// their parents, a tree built bottom-up is stored in post-order and a
+/// post-order walk reads the block front to back. Nodes beyond the expected
+/// counts are allocated from the regular arena.
+class ASTBulkBuilder {
+public:
+  explicit ASTBulkBuilder(ASTContext *context) : context(context) {}
+
+  ASTContext *getContext() const { return context; }
+
+  /// Expect `count` more nodes of kind `Class`.
+  template <typename Class> ASTBulkBuilder &expect(std::size_t count = 1) {
+    using ImplTy = typename Class::ImplTy;
+    size += count * llvm::alignTo(sizeof(ImplTy), alignof(ImplTy));
+    numNodes += count;
+    return *this;
+  }
+
+  /// Reserve the block for the expected nodes.
+  void Reserve() {
+    assert(!reserved && "Already reserved");
+    context->Reserve(size, numNodes);
+    reserved = true;
+  }
+
+  template <typename Class, typename... Args>
+  Class create(llvm::SMRange range, Args &&...args) {
+    assert(reserved && "Reserve before creating nodes");
+    ++numCreated;
+    return Class::create(range, context, std::forward<Args>(args)...);
+  }
+
+  std::size_t getReservedSize() const { return size; }
+  std::size_t getNumExpected() const { return numNodes; }
+  std::size_t getNumCreated() const { return numCreated; }
+
+private:
+  ASTContext *context;
+  std::size_t size = 0;
+  std::size_t numNodes = 0;
+  std::size_t numCreated = 0;
+  bool reserved = false;
+};
+
+} // namespace ast
+
+#endif // AST_BULK_BUILDER_H
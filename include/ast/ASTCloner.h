@@ -0,0 +1,63 @@
+#ifndef AST_CLONER_H
+#define AST_CLONER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace ast {
+
+class AST;
+class ASTContext;
+class ASTImpl;
+
+/// Copies ASTs into another ASTContext.
+///
+/// Every node is cloned at most once per cloner, so a node shared by several
+/// parents in the source is shared by the same parents in the copy.
+class ASTCloner {
+public:
+  explicit ASTCloner(ASTContext *context) : context(context) {}
+
+  ASTContext *getContext() const { return context; }
+
+  /// Clone `ast` and everything reachable from it. The arena space for all
+  /// nodes that are not cloned yet is reserved up front, and the copies are
+  /// laid out in it in depth-first pre-order.
+  AST clone(AST ast);
+
+  /// Clone the trees of all `roots` into one reserved block, one tree after
+  /// the other, and append the copies to `cloned`. Copying live trees into a
+  /// fresh context this way compacts them: parents sit right before their
+  /// children and nodes unreachable from `roots` are left behind.
+  void clone(llvm::ArrayRef<AST> roots, llvm::SmallVectorImpl<AST> &cloned);
+
+  /// Clone a single node reached while cloning its parent. Used by the
+  /// kind clone functions.
+  AST cloneNode(AST ast);
+
+  /// Returns the clone of `ast`, or null if it has not been cloned.
+  AST lookup(AST ast) const;
+
+  /// The cloned source nodes, each mapped to its clone.
+  const llvm::DenseMap<ASTImpl *, ASTImpl *> &getClones() const {
+    return remap;
+  }
+
+  /// Move the members of the source nodes into their clones instead of
+  /// copying them. The sources are left empty, so this is only for sources
+  /// that are destroyed right after, as in ASTContext::Collect.
+  void EnableMoving() { moving = true; }
+  bool isMoving() const { return moving; }
+
+private:
+  void reserve(llvm::ArrayRef<AST> roots);
+
+  ASTContext *context;
+  llvm::DenseMap<ASTImpl *, ASTImpl *> remap;
+  bool moving = false;
+};
+
+} // namespace ast
+
+#endif // AST_CLONER_H
@@ -1,13 +1,55 @@
 #ifndef AST_CONCEPT_H
 #define AST_CONCEPT_H
 
+#include "llvm/ADT/STLExtras.h"
+#include <functional>
+#include <type_traits>
+
 namespace ast {
+class AST;
 
 template <typename T>
 concept HasTraversalOrder = requires(T obj) {
   { obj.traversalOrder() };
 };
 
+/// An impl whose traversalOrder() yields mutable references to its members.
+template <typename T>
+concept HasMutableTraversalOrder = requires(T &obj) {
+  { obj.traversalOrder() };
+  requires !std::is_const_v<
+      std::remove_reference_t<decltype(obj.traversalOrder())>>;
+};
+
+/// An impl whose children are all fixed AST fields, located by byte offset.
+template <typename T>
+concept HasChildOffsets = requires { T::getChildOffsets(); };
+
+/// A kind with a generated straight-line walk over its AST members.
+template <typename T>
+concept HasGeneratedWalk =
+    requires(T ast, llvm::function_ref<void(AST)> fn) {
+      T::walkASTMembers(ast, fn);
+    };
+
+/// A kind with generated indexed access to its children.
+template <typename T>
+concept HasGeneratedChildAccess = requires(T ast, std::size_t idx) {
+  { T::getNumASTChildren(ast) } -> std::same_as<std::size_t>;
+  { T::getASTChild(ast, idx) };
+};
+
+/// A kind that knows which kinds may occur below it.
+template <typename T>
+concept HasDescendantKinds = requires { T::getDescendantKinds(); };
+
+/// A kind with a generated member-wise equality.
+template <typename T>
+concept HasGeneratedEqual =
+    requires(T ast, const std::function<bool(AST, AST)> &childEqual) {
+      { T::isEqualASTMembers(ast, ast, childEqual) } -> std::same_as<bool>;
+    };
+
 } // namespace ast
 
 #endif // AST_CONCEPT_H
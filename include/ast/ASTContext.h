@@ -2,19 +2,31 @@
 #define AST_CONTEXT_H
 
 #include "ast/ASTKindProperty.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
 #include <memory>
+#include <type_traits>
 
 namespace ast {
 
+class AST;
+class ASTArena;
 class ASTSet;
+class ASTBuilder;
+class ASTImpl;
 class ASTContextImpl;
 class ASTSetRegistry;
+class ASTSideTableBase;
 
 class ASTContext {
 public:
   using AllocSetFn = std::unique_ptr<ASTSet> (*)(ASTContext *);
+  using AllocSideTableFn =
+      std::unique_ptr<ASTSideTableBase> (*)(ASTContext *);
 
   ASTContext();
+  /// Create a context that shares the kind table of `registry` instead of
+  /// building its own. The registry must be frozen.
   ASTContext(ASTSetRegistry &registry);
   ~ASTContext();
 
@@ -27,24 +39,153 @@ public:
 
   template <typename Class, typename... Args> Class *Alloc(Args &&...args);
 
+  /// Raw memory from the current arena, released with it. Nothing is
+  /// destroyed.
+  void *Allocate(std::size_t size, std::size_t align) {
+    return allocImpl(size, align, nullptr);
+  }
+
+  /// Reserve one contiguous block of `size` bytes for the next allocations,
+  /// which are expected to hold `numObjects` objects. Allocations that do not
+  /// fit into the block fall back to the regular arena.
+  void Reserve(std::size_t size, std::size_t numObjects = 0);
+
   ASTKindProperty *GetASTKindProperty(ID id);
 
+  /// Move the nodes reachable from `roots` to fresh arena memory, updating
+  /// `roots` to the moved nodes, then destroy the nodes left behind and
+  /// release the old arena. Any other handle into this context is
+  /// invalidated. Side table values, change tracking state and parent links
+  /// among the moved nodes carry over to them; those of the other nodes are
+  /// dropped. Side table values holding handles must be recomputed.
+  void Collect(llvm::MutableArrayRef<AST> roots);
+
+  /// Bytes of arena memory held for nodes.
+  std::size_t getAllocatedBytes() const;
+
+  /// Number of node indices handed out, see ASTImpl::getIndex. Indices are
+  /// not reused, except that Collect numbers the moved nodes from zero.
+  std::uint32_t getNumNodeIndices() const { return numNodeIndices; }
+
+  /// While alive, routes the allocations of its context into a separate
+  /// arena, which is released in bulk when the region ends. Regions nest and
+  /// must end in reverse order. Nodes created in a region must not be
+  /// referenced by nodes outside of it once it ends; see EnableRegionChecks.
+  class Region {
+  public:
+    explicit Region(ASTContext *context);
+    ~Region();
+
+    Region(const Region &) = delete;
+    Region &operator=(const Region &) = delete;
+
+    ASTContext *getContext() const { return context; }
+
+    /// Raw memory from the arena of this region, released with it. A block
+    /// reserved with ASTContext::Reserve is left to the nodes.
+    void *Allocate(std::size_t size, std::size_t align);
+
+    /// True if `ast` was allocated in this region.
+    bool contains(AST ast) const;
+    std::size_t getAllocatedBytes() const;
+
+  private:
+    ASTContext *context;
+    ASTArena *arena;
+    /// Nodes created in the region are numbered from here on.
+    std::uint32_t firstIndex;
+  };
+
+  /// Record the nodes created from now on, and check when a region ends that
+  /// none of the recorded nodes outside of it points into it. Meant for debug
+  /// builds: every recorded node is visited at the end of every region.
+  void EnableRegionChecks();
+  bool isCheckingRegions() const { return checkingRegions; }
+
   template <typename Set> ASTSet *GetOrRegisterASTSet();
 
+  /// Returns true if the kind table is borrowed from an ASTSetRegistry.
+  bool isSharingKinds() const;
+
+  /// Returns the side table of type `Table` attached to this context, creating
+  /// it on first use.
+  template <typename Table> Table &GetOrCreateSideTable();
+
+  /// Start recording parent links of the nodes created from now on, so that
+  /// an in-place mutation marks the node dirty and its ancestors
+  /// subtree-dirty.
+  void EnableChangeTracking();
+  bool isTrackingChanges() const { return trackingChanges; }
+
+  /// Reset the dirty state of every node marked since the last call.
+  void ClearChanges();
+
+  /// Compute a summary of the subtree of every node created from now on:
+  /// its size, height and the kinds below it. Parent links are recorded as
+  /// with change tracking, so that an in-place mutation refreshes the
+  /// summaries of the mutated node and of its ancestors.
+  void EnableSummaries();
+  bool isComputingSummaries() const { return computingSummaries; }
+
 private:
+  friend class ::ast::ASTBuilder;
+  friend class ::ast::ASTImpl;
+
+  bool isRecordingParents() const {
+    return trackingChanges || computingSummaries;
+  }
+  /// True if an in-place mutation has to be reported to markModified.
+  bool isObservingMutations() const {
+    return trackingChanges || hasSideTables;
+  }
+  /// Subtree summary of a node, all zero if it has none.
+  struct NodeSummary {
+    std::uint64_t descendantKindMask = 0;
+    std::uint32_t subtreeSize = 0;
+    std::uint16_t height = 0;
+  };
+  NodeSummary getSummary(std::uint32_t idx) const {
+    return idx < summaries.size() ? summaries[idx] : NodeSummary{};
+  }
+
+  bool isDirty(std::uint32_t idx) const {
+    return idx < dirtyNodes.size() && dirtyNodes.test(idx);
+  }
+  bool isSubtreeDirty(std::uint32_t idx) const {
+    return idx < subtreeDirtyNodes.size() && subtreeDirtyNodes.test(idx);
+  }
+  void recordParent(ASTImpl *child, ASTImpl *parent);
+  void eraseParent(ASTImpl *child, ASTImpl *parent);
+  void markModified(ASTImpl *impl);
+  void refreshSummaries(ASTImpl *modified);
+  void recordNode(ASTImpl *node);
+
   void *allocImpl(std::size_t size, std::size_t align,
                   void (*destructor)(void *));
 
   void *getOrRegisterASTSetImpl(ID id, AllocSetFn fn);
 
+  void *getOrCreateSideTableImpl(ID id, AllocSideTableFn fn);
+
   ASTContextImpl *impl;
+  std::uint32_t numNodeIndices = 0;
+  bool trackingChanges = false;
+  bool computingSummaries = false;
+  bool checkingRegions = false;
+  bool hasSideTables = false;
+  /// Change tracking state by node index.
+  llvm::BitVector dirtyNodes;
+  llvm::BitVector subtreeDirtyNodes;
+  /// Subtree summaries by node index.
+  llvm::SmallVector<NodeSummary, 0> summaries;
 };
 
 template <typename Class, typename... Args>
 Class *ASTContext::Alloc(Args &&...args) {
-  void *ptr = allocImpl(
-      sizeof(Class), alignof(Class),
-      +[](void *ptr) { static_cast<Class *>(ptr)->~Class(); });
+  void (*destructor)(void *) = nullptr;
+  if constexpr (!std::is_trivially_destructible_v<Class>)
+    destructor = +[](void *ptr) { static_cast<Class *>(ptr)->~Class(); };
+  void *ptr = allocImpl(sizeof(Class), alignof(Class), destructor);
   return new (ptr) Class(std::forward<Args>(args)...);
 }
 
@@ -56,6 +197,15 @@ template <typename Set> ASTSet *ASTContext::GetOrRegisterASTSet() {
   return static_cast<Set *>(set);
 }
 
+template <typename Table> Table &ASTContext::GetOrCreateSideTable() {
+  void *table = getOrCreateSideTableImpl(
+      ID::get<Table>(),
+      +[](ASTContext *ctx) -> std::unique_ptr<ASTSideTableBase> {
+        return std::make_unique<Table>(ctx);
+      });
+  return *static_cast<Table *>(static_cast<ASTSideTableBase *>(table));
+}
+
 } // namespace ast
 
 #endif // AST_CONTEXT_H
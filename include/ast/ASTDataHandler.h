@@ -1,13 +1,21 @@
 #ifndef AST_DATA_HANDLER_H
 #define AST_DATA_HANDLER_H
 
+#include "ast/ASTMap.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace ast {
@@ -15,24 +23,88 @@ class AST;
 }
 
 namespace ast::detail {
+/// Compares two child ASTs met while comparing the members of their parents.
+using ChildEqualFn = std::function<bool(AST, AST)>;
+/// Hashes a child AST met while hashing the members of its parent.
+using ChildHashFn = std::function<llvm::hash_code(AST)>;
+
+/// True if a tree member of type T may hold AST children. Map keys are not
+/// walked, so only the values count.
+template <typename T> struct MayHoldAST : std::is_base_of<AST, T> {};
+template <typename... Ts>
+struct MayHoldAST<std::tuple<Ts...>>
+    : std::disjunction<MayHoldAST<std::remove_cvref_t<Ts>>...> {};
+template <typename F, typename S>
+struct MayHoldAST<std::pair<F, S>>
+    : std::disjunction<MayHoldAST<F>, MayHoldAST<S>> {};
+template <typename T>
+struct MayHoldAST<std::optional<T>> : MayHoldAST<T> {};
+template <typename... Ts>
+struct MayHoldAST<std::variant<Ts...>>
+    : std::disjunction<MayHoldAST<Ts>...> {};
+template <typename T> struct MayHoldAST<std::vector<T>> : MayHoldAST<T> {};
+template <typename T>
+struct MayHoldAST<llvm::SmallVector<T>> : MayHoldAST<T> {};
+template <typename K, typename V>
+struct MayHoldAST<ASTMap<K, V>> : MayHoldAST<V> {};
+template <typename K, typename V>
+struct MayHoldAST<llvm::DenseMap<K, V>> : MayHoldAST<V> {};
+
+/// A position among the children of an AST, so that iterating them resumes
+/// where the last step stopped: the tree member, the element of a container
+/// member, and the child within that element.
+struct ChildCursor {
+  std::size_t member = 0;
+  std::size_t element = 0;
+  std::size_t offset = 0;
+};
+
 template <typename T, typename Enable = void> struct ASTDataHandler {
-  /// static bool isEqual(const T &lhs, const T &rhs);
+  /// static bool isEqual(const T &lhs, const T &rhs, const ChildEqualFn &);
+  /// static llvm::hash_code hash(const T &data, const ChildHashFn &);
   /// static void walk(const T &data, std::function<void(AST)>);
+  /// static void remap(T &data, const std::function<AST(AST)> &);
+  /// static bool findChild(const T &data, std::size_t &idx, AST &child);
+  ///   Stops at the `idx`-th child and stores it in `child`. If `data` has
+  ///   fewer children, `idx` is decreased by their number and false is
+  ///   returned.
 };
 
 template <> struct ASTDataHandler<std::string> {
-  static bool isEqual(const std::string &lhs, const std::string &rhs) {
+  static bool isEqual(const std::string &lhs, const std::string &rhs,
+                      const ChildEqualFn &) {
     return lhs == rhs;
   }
+  static llvm::hash_code hash(const std::string &data, const ChildHashFn &) {
+    return llvm::hash_value(llvm::StringRef(data));
+  }
   static void walk(const std::string &data,
                    const std::function<void(AST)> &fn) {}
+  static void remap(std::string &data, const std::function<AST(AST)> &fn) {}
+  static bool findChild(const std::string &, std::size_t &, AST &) {
+    return false;
+  }
 };
 
 template <typename T>
 struct ASTDataHandler<T, std::enable_if_t<std::disjunction_v<
                              std::is_integral<T>, std::is_floating_point<T>>>> {
-  static bool isEqual(T lhs, T rhs) { return lhs == rhs; }
-  static void walk(T data, std::function<void(AST)> fn) {}
+  static bool isEqual(T lhs, T rhs, const ChildEqualFn &) { return lhs == rhs; }
+  static llvm::hash_code hash(T data, const ChildHashFn &) {
+    if constexpr (std::is_integral_v<T>) {
+      return llvm::hash_value(data);
+    } else {
+      // Hash the bits of a double so that equal values hash alike; +0.0 and
+      // -0.0 compare equal but differ in their sign bit.
+      double value = data == T(0) ? 0.0 : static_cast<double>(data);
+      std::uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return llvm::hash_value(bits);
+    }
+  }
+  static void walk(T data, const std::function<void(AST)> &fn) {}
+  static void remap(T &data, const std::function<AST(AST)> &fn) {}
+  static bool findChild(T, std::size_t &, AST &) { return false; }
 };
 
 template <typename... Ts> struct ASTDataHandler<std::tuple<Ts...>> {
@@ -40,15 +112,29 @@ template <typename... Ts> struct ASTDataHandler<std::tuple<Ts...>> {
 
   template <std::size_t... I>
   static bool isEqual(const Tuple &lhs, const Tuple &rhs,
+                      const ChildEqualFn &childEqual,
                       std::index_sequence<I...>) {
     return (
         ASTDataHandler<std::remove_cvref_t<std::tuple_element_t<I, Tuple>>>::
-            isEqual(std::get<I>(lhs), std::get<I>(rhs)) &&
+            isEqual(std::get<I>(lhs), std::get<I>(rhs), childEqual) &&
         ...);
   }
 
-  static bool isEqual(const Tuple &lhs, const Tuple &rhs) {
-    return isEqual(lhs, rhs, std::make_index_sequence<sizeof...(Ts)>{});
+  static bool isEqual(const Tuple &lhs, const Tuple &rhs,
+                      const ChildEqualFn &childEqual) {
+    return isEqual(lhs, rhs, childEqual,
+                   std::make_index_sequence<sizeof...(Ts)>{});
+  }
+
+  static llvm::hash_code hash(const Tuple &data,
+                              const ChildHashFn &childHash) {
+    return std::apply(
+        [&]<typename... Args>(Args &&...args) {
+          return llvm::hash_combine(
+              ASTDataHandler<std::remove_cvref_t<Args>>::hash(args,
+                                                              childHash)...);
+        },
+        data);
   }
 
   static void walk(const Tuple &data, const std::function<void(AST)> &fn) {
@@ -58,48 +144,135 @@ template <typename... Ts> struct ASTDataHandler<std::tuple<Ts...>> {
         },
         data);
   }
+
+  static void remap(Tuple &data, const std::function<AST(AST)> &fn) {
+    std::apply(
+        [&]<typename... Args>(Args &...args) {
+          (ASTDataHandler<std::remove_cvref_t<Args>>::remap(args, fn), ...);
+        },
+        data);
+  }
+
+  static bool findChild(const Tuple &data, std::size_t &idx, AST &child) {
+    return std::apply(
+        [&]<typename... Args>(Args &&...args) {
+          return (ASTDataHandler<std::remove_cvref_t<Args>>::findChild(
+                      args, idx, child) ||
+                  ...);
+        },
+        data);
+  }
 };
 
 template <typename F, typename S> struct ASTDataHandler<std::pair<F, S>> {
   using Pair = std::pair<F, S>;
 
-  static bool isEqual(const Pair &lhs, const Pair &rhs) {
-    return ASTDataHandler<F>::isEqual(lhs.first, rhs.first) &&
-           ASTDataHandler<S>::isEqual(lhs.second, rhs.second);
+  static bool isEqual(const Pair &lhs, const Pair &rhs,
+                      const ChildEqualFn &childEqual) {
+    return ASTDataHandler<F>::isEqual(lhs.first, rhs.first, childEqual) &&
+           ASTDataHandler<S>::isEqual(lhs.second, rhs.second, childEqual);
+  }
+
+  static llvm::hash_code hash(const Pair &data, const ChildHashFn &childHash) {
+    return llvm::hash_combine(ASTDataHandler<F>::hash(data.first, childHash),
+                              ASTDataHandler<S>::hash(data.second, childHash));
   }
 
   static void walk(const Pair &data, const std::function<void(AST)> &fn) {
     ASTDataHandler<F>::walk(data.first, fn);
     ASTDataHandler<S>::walk(data.second, fn);
   }
+
+  static void remap(Pair &data, const std::function<AST(AST)> &fn) {
+    ASTDataHandler<F>::remap(data.first, fn);
+    ASTDataHandler<S>::remap(data.second, fn);
+  }
+
+  static bool findChild(const Pair &data, std::size_t &idx, AST &child) {
+    return ASTDataHandler<F>::findChild(data.first, idx, child) ||
+           ASTDataHandler<S>::findChild(data.second, idx, child);
+  }
 };
 
 template <typename T> struct ASTDataHandler<std::optional<T>> {
   using Optional = std::optional<T>;
 
-  static bool isEqual(const Optional &lhs, const Optional &rhs) {
+  static bool isEqual(const Optional &lhs, const Optional &rhs,
+                      const ChildEqualFn &childEqual) {
     if (!lhs && !rhs)
       return true;
     if (lhs && rhs)
-      return ASTDataHandler<std::remove_cvref_t<T>>::isEqual(*lhs, *rhs);
+      return ASTDataHandler<std::remove_cvref_t<T>>::isEqual(*lhs, *rhs,
+                                                             childEqual);
     return false;
   };
 
+  static llvm::hash_code hash(const Optional &data,
+                              const ChildHashFn &childHash) {
+    if (!data)
+      return llvm::hash_value(false);
+    return llvm::hash_combine(
+        true, ASTDataHandler<std::remove_cvref_t<T>>::hash(*data, childHash));
+  }
+
   static void walk(const Optional &data, const std::function<void(AST)> &fn) {
     if (data)
       ASTDataHandler<std::remove_cvref_t<T>>::walk(*data, fn);
   }
+
+  static void remap(Optional &data, const std::function<AST(AST)> &fn) {
+    if (data)
+      ASTDataHandler<std::remove_cvref_t<T>>::remap(*data, fn);
+  }
+
+  static bool findChild(const Optional &data, std::size_t &idx, AST &child) {
+    return data && ASTDataHandler<std::remove_cvref_t<T>>::findChild(
+                       *data, idx, child);
+  }
 };
 
 template <typename T>
-bool vectorIsEqualImpl(llvm::ArrayRef<T> lhs, llvm::ArrayRef<T> rhs) {
+bool vectorIsEqualImpl(llvm::ArrayRef<T> lhs, llvm::ArrayRef<T> rhs,
+                       const ChildEqualFn &childEqual) {
   if (lhs.size() != rhs.size())
     return false;
-  for (const auto &[l, r] : llvm::zip(lhs, rhs)) {
-    if (!ASTDataHandler<std::remove_cvref_t<T>>::isEqual(l, r))
-      return false;
+  if (lhs.data() == rhs.data())
+    return true;
+  if constexpr (std::is_integral_v<T>) {
+    // integers are equal exactly when their bytes are
+    return lhs.empty() ||
+           std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T)) == 0;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    // Not bytewise, since +0.0 == -0.0 and NaN != NaN. An early exit per
+    // element keeps the loop from being vectorized, so mismatches are
+    // accumulated over blocks and only checked after each block.
+    constexpr std::size_t blockSize = 64;
+    std::size_t idx = 0, size = lhs.size();
+    for (; idx + blockSize <= size; idx += blockSize) {
+      T mismatches = 0;
+      for (std::size_t offset = 0; offset != blockSize; ++offset)
+        mismatches += lhs[idx + offset] != rhs[idx + offset] ? T(1) : T(0);
+      if (mismatches)
+        return false;
+    }
+    return std::equal(lhs.begin() + idx, lhs.end(), rhs.begin() + idx);
+  } else {
+    for (const auto &[l, r] : llvm::zip(lhs, rhs)) {
+      if (!ASTDataHandler<std::remove_cvref_t<T>>::isEqual(l, r, childEqual))
+        return false;
+    }
+    return true;
   }
-  return true;
+}
+
+template <typename T>
+llvm::hash_code vectorHashImpl(llvm::ArrayRef<T> data,
+                               const ChildHashFn &childHash) {
+  llvm::hash_code result = llvm::hash_value(data.size());
+  for (const auto &elem : data)
+    result = llvm::hash_combine(
+        result, ASTDataHandler<std::remove_cvref_t<T>>::hash(elem, childHash));
+  return result;
 }
 
 template <typename T>
@@ -109,36 +282,362 @@ void vectorWalkImpl(llvm::ArrayRef<T> data,
     ASTDataHandler<std::remove_cvref_t<T>>::walk(elem, fn);
 }
 
+template <typename T>
+void vectorRemapImpl(llvm::MutableArrayRef<T> data,
+                     const std::function<AST(AST)> &fn) {
+  for (auto &elem : data)
+    ASTDataHandler<std::remove_cvref_t<T>>::remap(elem, fn);
+}
+
+template <typename T>
+bool vectorFindChildImpl(llvm::ArrayRef<T> data, std::size_t &idx,
+                         AST &child) {
+  if constexpr (std::is_base_of_v<AST, T>) {
+    // one child per element
+    if (idx < data.size()) {
+      child = data[idx];
+      return true;
+    }
+    idx -= data.size();
+    return false;
+  } else {
+    for (const auto &elem : data)
+      if (ASTDataHandler<std::remove_cvref_t<T>>::findChild(elem, idx, child))
+        return true;
+    return false;
+  }
+}
+
 template <typename T> struct ASTDataHandler<std::vector<T>> {
   using Vector = std::vector<T>;
 
-  static bool isEqual(const Vector &lhs, const Vector &rhs) {
-    return vectorIsEqualImpl<T>(lhs, rhs);
+  static bool isEqual(const Vector &lhs, const Vector &rhs,
+                      const ChildEqualFn &childEqual) {
+    return vectorIsEqualImpl<T>(lhs, rhs, childEqual);
+  }
+
+  static llvm::hash_code hash(const Vector &data,
+                              const ChildHashFn &childHash) {
+    return vectorHashImpl<T>(data, childHash);
   }
 
   static void walk(const Vector &data, const std::function<void(AST)> &fn) {
     vectorWalkImpl<T>(data, fn);
   }
+
+  static void remap(Vector &data, const std::function<AST(AST)> &fn) {
+    vectorRemapImpl<T>(data, fn);
+  }
+
+  static bool findChild(const Vector &data, std::size_t &idx, AST &child) {
+    return vectorFindChildImpl<T>(data, idx, child);
+  }
 };
 
 template <typename T> struct ASTDataHandler<llvm::SmallVector<T>> {
   using Vector = llvm::SmallVector<T>;
 
-  static bool isEqual(const Vector &lhs, const Vector &rhs) {
-    return vectorIsEqualImpl<T>(lhs, rhs);
+  static bool isEqual(const Vector &lhs, const Vector &rhs,
+                      const ChildEqualFn &childEqual) {
+    return vectorIsEqualImpl<T>(lhs, rhs, childEqual);
+  }
+
+  static llvm::hash_code hash(const Vector &data,
+                              const ChildHashFn &childHash) {
+    return vectorHashImpl<T>(data, childHash);
   }
 
   static void walk(const Vector &data, const std::function<void(AST)> &fn) {
     vectorWalkImpl<T>(data, fn);
   }
+
+  static void remap(Vector &data, const std::function<AST(AST)> &fn) {
+    vectorRemapImpl<T>(data, fn);
+  }
+
+  static bool findChild(const Vector &data, std::size_t &idx, AST &child) {
+    return vectorFindChildImpl<T>(data, idx, child);
+  }
+};
+
+template <typename... Ts> struct ASTDataHandler<std::variant<Ts...>> {
+  using Variant = std::variant<Ts...>;
+
+  static bool isEqual(const Variant &lhs, const Variant &rhs,
+                      const ChildEqualFn &childEqual) {
+    if (lhs.index() != rhs.index())
+      return false;
+    return std::visit(
+        [&]<typename L, typename R>(const L &l, const R &r) {
+          if constexpr (std::is_same_v<L, R>)
+            return ASTDataHandler<std::remove_cvref_t<L>>::isEqual(l, r,
+                                                                   childEqual);
+          else
+            return false;
+        },
+        lhs, rhs);
+  }
+
+  static llvm::hash_code hash(const Variant &data,
+                              const ChildHashFn &childHash) {
+    return llvm::hash_combine(
+        data.index(), std::visit(
+                          [&]<typename T>(const T &value) {
+                            return ASTDataHandler<std::remove_cvref_t<T>>::hash(
+                                value, childHash);
+                          },
+                          data));
+  }
+
+  static void walk(const Variant &data, const std::function<void(AST)> &fn) {
+    std::visit(
+        [&]<typename T>(const T &value) {
+          ASTDataHandler<std::remove_cvref_t<T>>::walk(value, fn);
+        },
+        data);
+  }
+
+  static void remap(Variant &data, const std::function<AST(AST)> &fn) {
+    std::visit(
+        [&]<typename T>(T &value) {
+          ASTDataHandler<std::remove_cvref_t<T>>::remap(value, fn);
+        },
+        data);
+  }
+
+  static bool findChild(const Variant &data, std::size_t &idx, AST &child) {
+    return std::visit(
+        [&]<typename T>(const T &value) {
+          return ASTDataHandler<std::remove_cvref_t<T>>::findChild(value, idx,
+                                                                   child);
+        },
+        data);
+  }
+};
+
+/// Keys are plain data and never hold children; only values are walked and
+/// remapped.
+template <typename K, typename V> struct ASTDataHandler<ASTMap<K, V>> {
+  using Map = ASTMap<K, V>;
+
+  static bool isEqual(const Map &lhs, const Map &rhs,
+                      const ChildEqualFn &childEqual) {
+    if (lhs.size() != rhs.size())
+      return false;
+    for (const auto &[l, r] : llvm::zip(lhs, rhs)) {
+      if (!ASTDataHandler<K>::isEqual(l.first, r.first, childEqual) ||
+          !ASTDataHandler<V>::isEqual(l.second, r.second, childEqual))
+        return false;
+    }
+    return true;
+  }
+
+  static llvm::hash_code hash(const Map &data, const ChildHashFn &childHash) {
+    llvm::hash_code result = llvm::hash_value(data.size());
+    for (const auto &[key, value] : data)
+      result = llvm::hash_combine(result,
+                                  ASTDataHandler<K>::hash(key, childHash),
+                                  ASTDataHandler<V>::hash(value, childHash));
+    return result;
+  }
+
+  static void walk(const Map &data, const std::function<void(AST)> &fn) {
+    for (const auto &entry : data)
+      ASTDataHandler<V>::walk(entry.second, fn);
+  }
+
+  static void remap(Map &data, const std::function<AST(AST)> &fn) {
+    for (auto &entry : data)
+      ASTDataHandler<V>::remap(entry.second, fn);
+  }
+
+  static bool findChild(const Map &data, std::size_t &idx, AST &child) {
+    for (const auto &entry : data)
+      if (ASTDataHandler<V>::findChild(entry.second, idx, child))
+        return true;
+    return false;
+  }
+};
+
+/// Compared and hashed regardless of bucket order. Walk order follows the
+/// buckets; prefer ASTMap for tree members.
+template <typename K, typename V> struct ASTDataHandler<llvm::DenseMap<K, V>> {
+  using Map = llvm::DenseMap<K, V>;
+
+  static bool isEqual(const Map &lhs, const Map &rhs,
+                      const ChildEqualFn &childEqual) {
+    if (lhs.size() != rhs.size())
+      return false;
+    for (const auto &[key, value] : lhs) {
+      auto it = rhs.find(key);
+      if (it == rhs.end() ||
+          !ASTDataHandler<V>::isEqual(value, it->second, childEqual))
+        return false;
+    }
+    return true;
+  }
+
+  static llvm::hash_code hash(const Map &data, const ChildHashFn &childHash) {
+    // Entry hashes are summed so that the bucket order does not matter.
+    std::size_t sum = 0;
+    for (const auto &[key, value] : data)
+      sum += llvm::hash_combine(ASTDataHandler<K>::hash(key, childHash),
+                                ASTDataHandler<V>::hash(value, childHash));
+    return llvm::hash_combine(data.size(), sum);
+  }
+
+  static void walk(const Map &data, const std::function<void(AST)> &fn) {
+    for (const auto &entry : data)
+      ASTDataHandler<V>::walk(entry.second, fn);
+  }
+
+  static void remap(Map &data, const std::function<AST(AST)> &fn) {
+    for (auto &entry : data)
+      ASTDataHandler<V>::remap(entry.second, fn);
+  }
+
+  static bool findChild(const Map &data, std::size_t &idx, AST &child) {
+    for (const auto &entry : data)
+      if (ASTDataHandler<V>::findChild(entry.second, idx, child))
+        return true;
+    return false;
+  }
 };
 
 template <typename T>
 struct ASTDataHandler<T, std::enable_if_t<std::is_base_of_v<AST, T>>> {
-  static bool isEqual(const T lhs, const T rhs) { return lhs.isEqual(rhs); }
+  static bool isEqual(const T lhs, const T rhs,
+                      const ChildEqualFn &childEqual) {
+    return lhs == rhs || childEqual(lhs, rhs);
+  }
+  static llvm::hash_code hash(const T data, const ChildHashFn &childHash) {
+    return childHash(data);
+  }
   static void walk(T data, const std::function<void(AST)> &fn) { fn(data); }
+  static void remap(T &data, const std::function<AST(AST)> &fn) {
+    data = fn(data).template cast_if_present<T>();
+  }
+  static bool findChild(const T data, std::size_t &idx, AST &child) {
+    if (idx == 0) {
+      child = data;
+      return true;
+    }
+    --idx;
+    return false;
+  }
 };
 
+template <typename T>
+bool nextMemberChild(const T &data, ChildCursor &cursor, AST &child);
+template <typename T>
+bool nextMemberChild(const std::optional<T> &data, ChildCursor &cursor,
+                     AST &child);
+template <typename... Ts>
+bool nextMemberChild(const std::variant<Ts...> &data, ChildCursor &cursor,
+                     AST &child);
+template <typename T>
+bool nextMemberChild(const std::vector<T> &data, ChildCursor &cursor,
+                     AST &child);
+template <typename T>
+bool nextMemberChild(const llvm::SmallVector<T> &data, ChildCursor &cursor,
+                     AST &child);
+template <typename K, typename V>
+bool nextMemberChild(const ASTMap<K, V> &data, ChildCursor &cursor,
+                     AST &child);
+
+/// Stores the child of a tree member at `cursor` in `child` and moves the
+/// cursor past it. Returns false once the member has no children left.
+template <typename T>
+bool nextMemberChild(const T &data, ChildCursor &cursor, AST &child) {
+  std::size_t idx = cursor.offset;
+  if (!ASTDataHandler<std::remove_cvref_t<T>>::findChild(data, idx, child))
+    return false;
+  ++cursor.offset;
+  return true;
+}
+
+template <typename T>
+bool nextMemberChild(const std::optional<T> &data, ChildCursor &cursor,
+                     AST &child) {
+  return data && nextMemberChild(*data, cursor, child);
+}
+
+template <typename... Ts>
+bool nextMemberChild(const std::variant<Ts...> &data, ChildCursor &cursor,
+                     AST &child) {
+  return std::visit(
+      [&](const auto &value) { return nextMemberChild(value, cursor, child); },
+      data);
+}
+
+/// Containers resume at the element of the cursor, so a step only searches
+/// the children of one element.
+template <typename T, typename GetFn>
+bool nextElementChild(llvm::ArrayRef<T> data, ChildCursor &cursor, AST &child,
+                      GetFn get) {
+  using Value = std::remove_cvref_t<decltype(get(data.front()))>;
+  if constexpr (std::is_arithmetic_v<Value>) {
+    return false;
+  } else {
+    for (; cursor.element < data.size(); ++cursor.element, cursor.offset = 0) {
+      std::size_t idx = cursor.offset;
+      if (ASTDataHandler<Value>::findChild(get(data[cursor.element]), idx,
+                                           child)) {
+        ++cursor.offset;
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+template <typename T>
+bool nextMemberChild(const std::vector<T> &data, ChildCursor &cursor,
+                     AST &child) {
+  return nextElementChild<T>(data, cursor, child,
+                             [](const T &elem) -> const T & { return elem; });
+}
+
+template <typename T>
+bool nextMemberChild(const llvm::SmallVector<T> &data, ChildCursor &cursor,
+                     AST &child) {
+  return nextElementChild<T>(data, cursor, child,
+                             [](const T &elem) -> const T & { return elem; });
+}
+
+template <typename K, typename V>
+bool nextMemberChild(const ASTMap<K, V> &data, ChildCursor &cursor,
+                     AST &child) {
+  using Entry = typename ASTMap<K, V>::value_type;
+  return nextElementChild<Entry>(
+      llvm::ArrayRef<Entry>(data.begin(), data.end()), cursor, child,
+      [](const Entry &entry) -> const V & { return entry.second; });
+}
+
+template <typename Tuple, std::size_t... I>
+bool nextChild(const Tuple &members, ChildCursor &cursor, AST &child,
+               std::index_sequence<I...>) {
+  for (; cursor.member < sizeof...(I);
+       ++cursor.member, cursor.element = cursor.offset = 0) {
+    bool found = false;
+    ((I == cursor.member &&
+      (found = nextMemberChild(std::get<I>(members), cursor, child))),
+     ...);
+    if (found)
+      return true;
+  }
+  return false;
+}
+
+/// Stores the child of the traversal order `members` at `cursor` in `child`
+/// and moves the cursor past it. Returns false after the last child. Null
+/// children are returned like any other.
+template <typename... Ts>
+bool nextChild(const std::tuple<Ts...> &members, ChildCursor &cursor,
+               AST &child) {
+  return nextChild(members, cursor, child, std::index_sequence_for<Ts...>{});
+}
+
 } // namespace ast::detail
 
 #endif // AST_DATA_HANDLER_H
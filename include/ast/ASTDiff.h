@@ -0,0 +1,71 @@
+#ifndef AST_DIFF_H
+#define AST_DIFF_H
+
+#include "ast/AST.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace ast {
+
+/// One step of the edit script that turns one AST into another.
+struct ASTEdit {
+  enum class Kind {
+    /// `from` and `to` are the same kind but their own members differ. Their
+    /// children are diffed and reported separately.
+    Update,
+    /// `from` is replaced by `to` as a whole.
+    Replace,
+    /// `to` is inserted as child `index` of the new child list of `parent`.
+    Insert,
+    /// `from`, child `index` of `parent`, is removed.
+    Delete,
+  };
+
+  Kind kind;
+  AST from;
+  AST to;
+  /// Parent of the edited slot on the `from` side; null for the root.
+  AST parent;
+  std::size_t index;
+};
+
+/// Computes the edit script between two ASTs, possibly from different
+/// contexts.
+///
+/// The trees are matched top-down. Subtrees with equal structural hashes are
+/// confirmed with AST::isEqual and not diffed any further. Children of matching
+/// nodes are paired by position; when their counts differ, the common prefix
+/// and suffix are matched first and the rest is reported as inserts and
+/// deletes.
+class ASTDiff {
+public:
+  using EditFn = llvm::function_ref<void(const ASTEdit &)>;
+
+  /// Without `verifyHashes`, subtrees with equal hashes are taken as
+  /// identical without being compared. The cost is then proportional to the
+  /// changed part of the trees plus one hashing pass, but a hash collision
+  /// silently yields a wrong edit script.
+  explicit ASTDiff(bool verifyHashes = true) : verifyHashes(verifyHashes) {}
+
+  /// Stream the edits turning `from` into `to` to `fn`, parents first.
+  void Diff(AST from, AST to, EditFn fn);
+
+  llvm::SmallVector<ASTEdit> Diff(AST from, AST to);
+
+  /// Structural hash of `ast`, memoized over the lifetime of this object.
+  llvm::hash_code getHash(AST ast);
+
+private:
+  bool isSame(AST from, AST to);
+  void diffNode(AST from, AST to, AST parent, std::size_t index, EditFn fn);
+  void diffChildren(AST from, AST to, EditFn fn);
+
+  bool verifyHashes;
+  llvm::DenseMap<ASTImpl *, llvm::hash_code> hashes;
+};
+
+} // namespace ast
+
+#endif // AST_DIFF_H
@@ -0,0 +1,131 @@
+#ifndef AST_GENERATOR_H
+#define AST_GENERATOR_H
+
+#include "ast/AST.h"
+#include "ast/ASTTypeID.h"
+#include "llvm/ADT/SmallVector.h"
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ast {
+
+/// A lazy sequence produced by a coroutine with `co_yield`.
+///
+///   for (auto integer : generateKind<Integer>(root))
+///     if (integer.getValue() == 0)
+///       break;
+///
+/// Nothing runs until the sequence is iterated, and the coroutine only runs
+/// as far as the values pulled from it. A generator is iterated once.
+template <typename T = AST> class ASTGenerator {
+public:
+  struct promise_type {
+    std::optional<T> value;
+
+    ASTGenerator get_return_object() {
+      return ASTGenerator(Handle::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(T yielded) {
+      value = std::move(yielded);
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  class iterator {
+  public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(Handle handle) : handle(handle) {}
+
+    const T &operator*() const { return *handle.promise().value; }
+    const T *operator->() const { return &*handle.promise().value; }
+
+    iterator &operator++() {
+      handle.resume();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+
+    friend bool operator==(const iterator &it, std::default_sentinel_t) {
+      return !it.handle || it.handle.done();
+    }
+
+  private:
+    Handle handle;
+  };
+
+  ASTGenerator(ASTGenerator &&other)
+      : handle(std::exchange(other.handle, nullptr)) {}
+  ASTGenerator &operator=(ASTGenerator &&other) {
+    if (this != &other) {
+      if (handle)
+        handle.destroy();
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  ASTGenerator(const ASTGenerator &) = delete;
+  ASTGenerator &operator=(const ASTGenerator &) = delete;
+  ~ASTGenerator() {
+    if (handle)
+      handle.destroy();
+  }
+
+  iterator begin() {
+    if (handle)
+      handle.resume();
+    return iterator(handle);
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  explicit ASTGenerator(Handle handle) : handle(handle) {}
+
+  Handle handle;
+};
+
+/// `root` and its descendants, parents before children. Null children are
+/// skipped and shared subtrees are visited once per occurrence.
+ASTGenerator<AST> generatePreOrder(AST root);
+/// `root` and its descendants, children before parents.
+ASTGenerator<AST> generatePostOrder(AST root);
+/// The ASTs of the given kinds in pre-order. Subtrees that cannot contain
+/// any of the kinds, as told by their kind property, are not entered.
+ASTGenerator<AST> generateKinds(AST root, llvm::SmallVector<ID> kinds);
+
+template <typename Kind> ASTGenerator<Kind> generateKind(AST root) {
+  for (AST ast : generateKinds(root, {ID::get<Kind>()}))
+    co_yield ast.cast<Kind>();
+}
+
+/// The values of `source` satisfying `pred`.
+template <typename T, typename Pred>
+ASTGenerator<T> filter(ASTGenerator<T> source, Pred pred) {
+  for (const T &value : source)
+    if (pred(value))
+      co_yield value;
+}
+
+/// `fn` applied to the values of `source`.
+template <typename T, typename Fn,
+          typename R = std::remove_cvref_t<std::invoke_result_t<Fn &, T>>>
+ASTGenerator<R> transform(ASTGenerator<T> source, Fn fn) {
+  for (const T &value : source)
+    co_yield fn(value);
+}
+
+} // namespace ast
+
+#endif // AST_GENERATOR_H
@@ -1,43 +1,135 @@
 #ifndef AST_KIND_PROPERTY_H
 #define AST_KIND_PROPERTY_H
 
+#include "ast/ASTConcept.h"
+#include "ast/ASTDataHandler.h"
 #include "ast/ASTPrinter.h"
 #include "ast/ASTTypeID.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
 #include <functional>
 
 namespace ast {
 
 class AST;
 class ASTBuilder;
+class ASTCloner;
+class ASTKindTable;
 class ASTKindProperty {
 public:
-  using ChildrenWalkFn = std::function<void(AST, std::function<void(AST)>)>;
-  using EqualFn = std::function<bool(AST, AST)>;
+  using ChildrenWalkFn =
+      std::function<void(AST, llvm::function_ref<void(AST)>)>;
+  using NumChildrenFn = std::function<std::size_t(AST)>;
+  using ChildFn = std::function<AST(AST, std::size_t)>;
+  using NextChildFn = std::function<bool(AST, detail::ChildCursor &, AST &)>;
+  using EqualFn = std::function<bool(AST, AST, const detail::ChildEqualFn &)>;
+  using HashFn =
+      std::function<llvm::hash_code(AST, const detail::ChildHashFn &)>;
   using PrintFn = std::function<void(AST, ASTPrinter &)>;
+  using CloneFn = std::function<AST(AST, ASTCloner &)>;
+  using RemapChildrenFn =
+      std::function<void(AST, const std::function<AST(AST)> &)>;
+  /// A set of kinds, one bit per kind.
+  using KindMask = std::uint64_t;
 
   ID getID() const { return id; }
+  std::size_t getImplSize() const { return implSize; }
+  std::size_t getImplAlign() const { return implAlign; }
+
+  /// True if every child of this kind is a fixed AST field of the impl.
+  bool hasFixedChildren() const { return fixedChildren; }
+  /// Byte offsets of the fixed AST fields from the start of the ASTImpl, in
+  /// traversal order. Only meaningful if hasFixedChildren().
+  llvm::ArrayRef<std::uint32_t> getChildOffsets() const {
+    return childOffsets;
+  }
+
+  /// The bit of this kind in kind masks, assigned in registration order.
+  /// Kinds share bits once more than 64 are registered in one kind table, so
+  /// masks over-approximate.
+  KindMask getKindMask() const { return kindMask; }
+
+  /// False if no AST of kind `kind` can occur below an AST of this kind.
+  bool mayContain(ID kind) const {
+    return !boundedDescendants || llvm::is_contained(descendantKinds, kind);
+  }
+  /// The kinds that may occur below an AST of this kind, as a mask over the
+  /// kinds registered so far. All bits are set if they are not bounded.
+  KindMask getMayContainMask() const { return mayContainMask; }
 
   const auto &getChildrenWalkFn() const { return childrenWalkFn; }
+  const auto &getNumChildrenFn() const { return numChildrenFn; }
+  const auto &getChildFn() const { return childFn; }
+  const auto &getNextChildFn() const { return nextChildFn; }
   const auto &getEqualFn() const { return equalFn; }
+  const auto &getHashFn() const { return hashFn; }
   const auto &getPrintFn() const { return printFn; }
+  const auto &getCloneFn() const { return cloneFn; }
+  const auto &getRemapChildrenFn() const { return remapChildrenFn; }
 
 private:
   friend class ::ast::ASTBuilder;
+  friend class ::ast::ASTKindTable;
 
   template <typename Class> static ASTKindProperty get() {
-    return ASTKindProperty(ID::get<Class>(), Class::getChildrenWalkFn(),
-                           Class::getEqualFn(), Class::getPrintFn());
+    using ImplTy = typename Class::ImplTy;
+    if constexpr (HasTraversalOrder<Class>) {
+      using Members = std::remove_cvref_t<
+          decltype(std::declval<const Class &>().traversalOrder())>;
+      static_assert(HasMutableTraversalOrder<ImplTy> ||
+                        !detail::MayHoldAST<Members>::value,
+                    "AST kind with children must expose a mutable "
+                    "traversalOrder() on its impl to be cloned and remapped");
+    }
+    ASTKindProperty property(
+        ID::get<Class>(), sizeof(ImplTy), alignof(ImplTy),
+        Class::getChildrenWalkFn(), Class::getNumChildrenFn(),
+        Class::getChildFn(), Class::getNextChildFn(), Class::getEqualFn(),
+        Class::getHashFn(), Class::getPrintFn(), Class::getCloneFn(),
+        Class::getRemapChildrenFn());
+    if constexpr (HasChildOffsets<ImplTy>) {
+      property.fixedChildren = true;
+      property.childOffsets = ImplTy::getChildOffsets();
+    }
+    if constexpr (HasDescendantKinds<Class>) {
+      property.boundedDescendants = true;
+      property.descendantKinds = Class::getDescendantKinds();
+    }
+    return property;
   }
 
-  ASTKindProperty(ID id, ChildrenWalkFn childrenWalkFn, EqualFn equalFn,
-                  PrintFn printFn)
-      : id(id), childrenWalkFn(std::move(childrenWalkFn)),
-        equalFn(std::move(equalFn)), printFn(std::move(printFn)) {}
+  ASTKindProperty(ID id, std::size_t implSize, std::size_t implAlign,
+                  ChildrenWalkFn childrenWalkFn, NumChildrenFn numChildrenFn,
+                  ChildFn childFn, NextChildFn nextChildFn, EqualFn equalFn,
+                  HashFn hashFn, PrintFn printFn, CloneFn cloneFn,
+                  RemapChildrenFn remapChildrenFn)
+      : id(id), implSize(implSize), implAlign(implAlign),
+        childrenWalkFn(std::move(childrenWalkFn)),
+        numChildrenFn(std::move(numChildrenFn)), childFn(std::move(childFn)),
+        nextChildFn(std::move(nextChildFn)), equalFn(std::move(equalFn)),
+        hashFn(std::move(hashFn)), printFn(std::move(printFn)),
+        cloneFn(std::move(cloneFn)),
+        remapChildrenFn(std::move(remapChildrenFn)) {}
 
   const ID id;
+  const std::size_t implSize;
+  const std::size_t implAlign;
   const ChildrenWalkFn childrenWalkFn;
+  const NumChildrenFn numChildrenFn;
+  const ChildFn childFn;
+  const NextChildFn nextChildFn;
   const EqualFn equalFn;
+  const HashFn hashFn;
   const PrintFn printFn;
+  const CloneFn cloneFn;
+  const RemapChildrenFn remapChildrenFn;
+  bool fixedChildren = false;
+  llvm::SmallVector<std::uint32_t, 4> childOffsets;
+  KindMask kindMask = 0;
+  KindMask mayContainMask = ~KindMask(0);
+  bool boundedDescendants = false;
+  llvm::SmallVector<ID, 4> descendantKinds;
 };
 
 } // namespace ast
@@ -0,0 +1,94 @@
+#ifndef AST_LIST_H
+#define AST_LIST_H
+
+#include "ast/AST.h"
+#include "ast/ASTContext.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <algorithm>
+#include <memory>
+
+namespace ast {
+
+/// A growable list of nodes, meant for worklists. The first `N` elements are
+/// stored inline. Beyond that, a list created for an ASTContext::Region moves
+/// its elements to arena memory of the region, released with it, and any
+/// other list to heap memory, released with the list.
+template <unsigned N = 8> class ASTList {
+public:
+  using iterator = AST *;
+  using const_iterator = const AST *;
+
+  explicit ASTList(ASTContext *context) : context(context) {}
+  /// The list must not outlive `region`.
+  explicit ASTList(ASTContext::Region &region)
+      : context(region.getContext()), region(&region) {}
+
+  ASTList(const ASTList &) = delete;
+  ASTList &operator=(const ASTList &) = delete;
+
+  ASTContext *getContext() const { return context; }
+
+  void push_back(AST ast) {
+    if (numElements == capacity)
+      grow();
+    data[numElements++] = ast;
+  }
+
+  AST pop_back_val() {
+    assert(!empty() && "Empty list");
+    return data[--numElements];
+  }
+
+  AST back() const {
+    assert(!empty() && "Empty list");
+    return data[numElements - 1];
+  }
+
+  AST operator[](std::size_t idx) const {
+    assert(idx < numElements && "Index out of range");
+    return data[idx];
+  }
+
+  iterator begin() { return data; }
+  iterator end() { return data + numElements; }
+  const_iterator begin() const { return data; }
+  const_iterator end() const { return data + numElements; }
+
+  std::size_t size() const { return numElements; }
+  bool empty() const { return numElements == 0; }
+  /// False once the elements moved out of the inline storage.
+  bool isSmall() const { return data == inlineElements; }
+
+  void clear() { numElements = 0; }
+
+  operator llvm::ArrayRef<AST>() const { return {data, numElements}; }
+
+private:
+  void grow() {
+    auto newCapacity = capacity * 2;
+    if (region) {
+      auto *newData = static_cast<AST *>(
+          region->Allocate(newCapacity * sizeof(AST), alignof(AST)));
+      std::uninitialized_copy(begin(), end(), newData);
+      data = newData;
+    } else {
+      auto newElements = std::make_unique<AST[]>(newCapacity);
+      std::copy(begin(), end(), newElements.get());
+      heapElements = std::move(newElements);
+      data = heapElements.get();
+    }
+    capacity = newCapacity;
+  }
+
+  ASTContext *context;
+  ASTContext::Region *region = nullptr;
+  std::unique_ptr<AST[]> heapElements;
+  AST inlineElements[N];
+  AST *data = inlineElements;
+  std::size_t numElements = 0;
+  std::size_t capacity = N;
+};
+
+} // namespace ast
+
+#endif // AST_LIST_H
@@ -0,0 +1,115 @@
+#ifndef AST_MAP_H
+#define AST_MAP_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace ast {
+
+/// A map stored as a vector of entries sorted by key.
+///
+/// Used for Map tree members: it is compact, iterates in key order, and two
+/// maps with the same entries have the same layout whatever the insertion
+/// order, so comparing and hashing them element-wise is order-independent.
+/// Keys are plain data ordered by operator<.
+template <typename KeyT, typename ValueT> class ASTMap {
+public:
+  using value_type = std::pair<KeyT, ValueT>;
+  using Storage = llvm::SmallVector<value_type, 0>;
+  using iterator = typename Storage::iterator;
+  using const_iterator = typename Storage::const_iterator;
+
+  ASTMap() = default;
+  ASTMap(std::initializer_list<value_type> init)
+      : ASTMap(init.begin(), init.end()) {}
+
+  /// If a key occurs more than once, the first entry wins.
+  template <typename InputIt> ASTMap(InputIt first, InputIt last) {
+    entries.append(first, last);
+    llvm::stable_sort(entries, [](const value_type &lhs, const value_type &rhs) {
+      return lhs.first < rhs.first;
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const value_type &lhs, const value_type &rhs) {
+                                return !(lhs.first < rhs.first);
+                              }),
+                  entries.end());
+  }
+
+  iterator begin() { return entries.begin(); }
+  iterator end() { return entries.end(); }
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+
+  std::size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  void reserve(std::size_t size) { entries.reserve(size); }
+  void clear() { entries.clear(); }
+
+  iterator find(const KeyT &key) {
+    auto it = lowerBound(key);
+    return it != end() && !(key < it->first) ? it : end();
+  }
+  const_iterator find(const KeyT &key) const {
+    return const_cast<ASTMap *>(this)->find(key);
+  }
+
+  bool contains(const KeyT &key) const { return find(key) != end(); }
+  std::size_t count(const KeyT &key) const { return contains(key); }
+
+  /// Returns the value for `key`, or a default-constructed value.
+  ValueT lookup(const KeyT &key) const {
+    auto it = find(key);
+    return it != end() ? it->second : ValueT();
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(KeyT key, Args &&...args) {
+    auto it = lowerBound(key);
+    if (it != end() && !(key < it->first))
+      return {it, false};
+    it = entries.insert(it, value_type(std::piecewise_construct,
+                                       std::forward_as_tuple(std::move(key)),
+                                       std::forward_as_tuple(
+                                           std::forward<Args>(args)...)));
+    return {it, true};
+  }
+
+  std::pair<iterator, bool> insert(value_type entry) {
+    return try_emplace(std::move(entry.first), std::move(entry.second));
+  }
+
+  ValueT &operator[](const KeyT &key) { return try_emplace(key).first->second; }
+
+  bool erase(const KeyT &key) {
+    auto it = find(key);
+    if (it == end())
+      return false;
+    entries.erase(it);
+    return true;
+  }
+
+  /// Entries in key order.
+  llvm::ArrayRef<value_type> getEntries() const { return entries; }
+
+  bool operator==(const ASTMap &other) const {
+    return entries == other.entries;
+  }
+  bool operator!=(const ASTMap &other) const { return !(*this == other); }
+
+private:
+  iterator lowerBound(const KeyT &key) {
+    return llvm::partition_point(
+        entries, [&](const value_type &entry) { return entry.first < key; });
+  }
+
+  Storage entries;
+};
+
+} // namespace ast
+
+#endif // AST_MAP_H
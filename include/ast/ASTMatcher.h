@@ -0,0 +1,278 @@
+#ifndef AST_MATCHER_H
+#define AST_MATCHER_H
+
+#include "ast/AST.h"
+#include "ast/ASTTypeID.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <functional>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/// Tree patterns over AST.
+///
+///   m<TestFor>(any, m<Integer>(eq(0)), any, bind(to), any)
+///
+/// matches a TestFor whose second tree member is the Integer 0 and binds its
+/// fourth tree member to `to`. Sub-patterns of m<Kind> match the tree members
+/// of Kind positionally, in traversal order; m<Kind>() checks the kind only.
+namespace ast::match {
+
+/// Matches any value.
+struct AnyMatcher {
+  template <typename T> bool match(const T &) const { return true; }
+};
+inline constexpr AnyMatcher any{};
+
+/// Matches a value equal to `value`. Arithmetic values are converted to the
+/// type of the matched member first, so eq(0) compares without sign
+/// mismatches against unsigned members.
+template <typename V> class EqMatcher {
+public:
+  explicit EqMatcher(V value) : value(std::move(value)) {}
+
+  template <typename T> bool match(const T &data) const {
+    if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<V>)
+      return data == static_cast<T>(value);
+    else
+      return data == value;
+  }
+
+private:
+  V value;
+};
+
+template <typename V> EqMatcher<std::decay_t<V>> eq(V &&value) {
+  return EqMatcher<std::decay_t<V>>(std::forward<V>(value));
+}
+
+/// Matches what `sub` matches and stores the matched value in `out`.
+template <typename T, typename Sub> class BindMatcher {
+public:
+  BindMatcher(T &out, Sub sub) : out(out), sub(std::move(sub)) {}
+
+  template <typename U> bool match(const U &data) const {
+    if (!sub.match(data))
+      return false;
+    if constexpr (std::is_assignable_v<T &, const U &>)
+      out = data;
+    else
+      out = data.template cast<T>();
+    return true;
+  }
+
+  static ID getKind()
+    requires requires { Sub::getKind(); }
+  {
+    return Sub::getKind();
+  }
+
+private:
+  T &out;
+  Sub sub;
+};
+
+template <typename T, typename Sub = AnyMatcher>
+BindMatcher<T, Sub> bind(T &out, Sub sub = {}) {
+  return BindMatcher<T, Sub>(out, std::move(sub));
+}
+
+template <typename Pattern>
+concept HasPatternKind = requires { Pattern::getKind(); };
+
+/// Matches an AST of kind `Kind` whose tree members match `Subs`.
+template <typename Kind, typename... Subs> class NodeMatcher {
+public:
+  explicit NodeMatcher(Subs... subs) : subs(std::move(subs)...) {}
+
+  static ID getKind() { return ID::get<Kind>(); }
+
+  bool match(AST ast) const {
+    return ast && ast.getID() == getKind() && matchMembers(ast);
+  }
+
+  /// Match the tree members of `ast`, whose kind is known to be `Kind`.
+  bool matchMembers(AST ast) const {
+    if constexpr (sizeof...(Subs) == 0) {
+      return true;
+    } else {
+      auto concrete = ast.cast<Kind>();
+      const auto &members = concrete.traversalOrder();
+      static_assert(
+          std::tuple_size_v<std::remove_cvref_t<decltype(members)>> ==
+              sizeof...(Subs),
+          "Expected one sub-pattern per tree member");
+      return matchMembers(members, std::index_sequence_for<Subs...>{});
+    }
+  }
+
+  /// Collect the tree members whose sub-pattern is rooted at a fixed kind, as
+  /// (member, kind) pairs.
+  void getMemberKinds(
+      llvm::SmallVectorImpl<std::pair<unsigned, ID>> &memberKinds) const {
+    getMemberKinds(memberKinds, std::index_sequence_for<Subs...>{});
+  }
+
+  /// Returns the kind of tree member `member` of `ast`, whose kind is known to
+  /// be `Kind`, or the null ID if the member is not a non-null AST.
+  static ID getMemberKind(AST ast, unsigned member) {
+    auto concrete = ast.cast<Kind>();
+    const auto &members = concrete.traversalOrder();
+    using Members = std::remove_cvref_t<decltype(members)>;
+    constexpr auto numMembers = std::tuple_size_v<Members>;
+    return getMemberKind(members, member,
+                         std::make_index_sequence<numMembers>{});
+  }
+
+private:
+  using Tuple = std::tuple<Subs...>;
+
+  template <std::size_t... I>
+  static void
+  getMemberKinds(llvm::SmallVectorImpl<std::pair<unsigned, ID>> &memberKinds,
+                 std::index_sequence<I...>) {
+    (addMemberKind<I>(memberKinds), ...);
+  }
+
+  template <std::size_t I>
+  static void
+  addMemberKind(llvm::SmallVectorImpl<std::pair<unsigned, ID>> &memberKinds) {
+    using Sub = std::tuple_element_t<I, Tuple>;
+    if constexpr (HasPatternKind<Sub>)
+      memberKinds.emplace_back(I, Sub::getKind());
+  }
+
+  template <typename Members, std::size_t... I>
+  static ID getMemberKind(const Members &members, unsigned member,
+                          std::index_sequence<I...>) {
+    ID kind;
+    ((I == member ? (void)(kind = getKindOf(std::get<I>(members))) : void()),
+     ...);
+    return kind;
+  }
+
+  template <typename Member> static ID getKindOf(const Member &member) {
+    if constexpr (std::is_convertible_v<const Member &, AST>) {
+      if (AST child = member)
+        return child.getID();
+    }
+    return ID();
+  }
+
+  template <typename Members, std::size_t... I>
+  bool matchMembers(const Members &members, std::index_sequence<I...>) const {
+    return (std::get<I>(subs).match(std::get<I>(members)) && ...);
+  }
+
+  Tuple subs;
+};
+
+template <typename Kind, typename... Subs>
+NodeMatcher<Kind, std::decay_t<Subs>...> m(Subs &&...subs) {
+  return NodeMatcher<Kind, std::decay_t<Subs>...>(std::forward<Subs>(subs)...);
+}
+
+/// A set of patterns compiled into a dispatch table on the root kind.
+///
+/// Matching a node looks up the candidates for its kind once, so patterns
+/// rooted at other kinds are never tried, and the root kind check is shared
+/// by all candidates. Patterns rooted at `any` are candidates for every kind.
+/// Candidates are tried by decreasing benefit, then in insertion order.
+///
+/// The kind checks one level below the root are shared as well: the kind of
+/// each tree member is read at most once per matched node, and candidates
+/// whose sub-patterns expect another kind there are skipped without being run.
+/// Deeper levels are not shared; each remaining candidate runs its own
+/// sub-patterns.
+class PatternSet {
+public:
+  using MatchFn = std::function<bool(AST)>;
+
+  template <typename Pattern>
+  unsigned add(Pattern pattern, unsigned benefit = 1) {
+    assert(!compiled && "Cannot add patterns to a compiled set");
+    MatchFn matchFn;
+    ID kind;
+    llvm::SmallVector<std::pair<unsigned, ID>, 2> memberKinds;
+    ID (*getMemberKind)(AST, unsigned) = nullptr;
+    if constexpr (HasPatternKind<Pattern>) {
+      kind = Pattern::getKind();
+      if constexpr (requires { pattern.matchMembers(AST()); }) {
+        pattern.getMemberKinds(memberKinds);
+        getMemberKind = &Pattern::getMemberKind;
+        matchFn = [pattern = std::move(pattern)](AST ast) {
+          return pattern.matchMembers(ast);
+        };
+      } else {
+        matchFn = [pattern = std::move(pattern)](AST ast) {
+          return pattern.match(ast);
+        };
+      }
+    } else {
+      matchFn = [pattern = std::move(pattern)](AST ast) {
+        return pattern.match(ast);
+      };
+    }
+    patterns.push_back({kind, benefit, std::move(memberKinds), getMemberKind,
+                        std::move(matchFn)});
+    return patterns.size() - 1;
+  }
+
+  /// Build the dispatch table. Further patterns cannot be added.
+  void Compile();
+
+  bool isCompiled() const { return compiled; }
+  std::size_t size() const { return patterns.size(); }
+  unsigned getBenefit(unsigned pattern) const {
+    return patterns[pattern].benefit;
+  }
+
+  /// The patterns that may match an AST of kind `kind`, in trial order.
+  llvm::ArrayRef<unsigned> getCandidates(ID kind) const;
+
+  /// Returns the first pattern matching `ast`.
+  std::optional<unsigned> match(AST ast) const;
+
+  /// Calls `fn` with every pattern matching `ast` until it returns false.
+  template <typename Fn> void matchAll(AST ast, Fn &&fn) const {
+    if (!ast)
+      return;
+    MemberKindCache cache;
+    for (unsigned pattern : getCandidates(ast.getID()))
+      if (matchesMemberKinds(patterns[pattern], ast, cache) &&
+          patterns[pattern].matchFn(ast) && !fn(pattern))
+        return;
+  }
+
+private:
+  struct Entry {
+    /// Root kind, or the null ID if the pattern is rooted at `any`.
+    ID kind;
+    unsigned benefit;
+    /// Kinds expected at tree members of the root, as (member, kind) pairs.
+    llvm::SmallVector<std::pair<unsigned, ID>, 2> memberKinds;
+    /// Reads the kind of a tree member of a root of kind `kind`.
+    ID (*getMemberKind)(AST, unsigned);
+    MatchFn matchFn;
+  };
+
+  /// Member kinds of the node being matched, read so far.
+  using MemberKindCache = llvm::SmallVector<std::pair<unsigned, ID>, 4>;
+
+  /// Returns false if a tree member of `ast` has another kind than `entry`
+  /// expects there.
+  static bool matchesMemberKinds(const Entry &entry, AST ast,
+                                 MemberKindCache &cache);
+
+  llvm::SmallVector<Entry> patterns;
+  llvm::DenseMap<ID, llvm::SmallVector<unsigned>> dispatch;
+  llvm::SmallVector<unsigned> anyKind;
+  bool compiled = false;
+};
+
+} // namespace ast::match
+
+#endif // AST_MATCHER_H
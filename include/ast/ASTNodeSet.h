@@ -0,0 +1,71 @@
+#ifndef AST_NODE_SET_H
+#define AST_NODE_SET_H
+
+#include "ast/AST.h"
+#include "ast/ASTContext.h"
+#include "llvm/ADT/BitVector.h"
+#include <algorithm>
+
+namespace ast {
+
+/// A set of nodes of one context, stored as a bit vector over the node
+/// indices. Membership tests are bit tests; the set takes one bit per node
+/// index of the context and cannot be iterated.
+class ASTNodeSet {
+public:
+  explicit ASTNodeSet(ASTContext *context)
+      : context(context), bits(context->getNumNodeIndices()) {}
+
+  ASTContext *getContext() const { return context; }
+
+  /// Returns true if `ast` was not in the set.
+  bool insert(AST ast) {
+    auto idx = getIndex(ast);
+    if (idx >= bits.size())
+      bits.resize(std::max<std::size_t>(idx + 1,
+                                        context->getNumNodeIndices()));
+    if (bits.test(idx))
+      return false;
+    bits.set(idx);
+    ++numNodes;
+    return true;
+  }
+
+  /// Returns true if `ast` was in the set.
+  bool erase(AST ast) {
+    if (!contains(ast))
+      return false;
+    bits.reset(getIndex(ast));
+    --numNodes;
+    return true;
+  }
+
+  bool contains(AST ast) const {
+    auto idx = getIndex(ast);
+    return idx < bits.size() && bits.test(idx);
+  }
+  std::size_t count(AST ast) const { return contains(ast); }
+
+  std::size_t size() const { return numNodes; }
+  bool empty() const { return numNodes == 0; }
+
+  void clear() {
+    bits.reset();
+    numNodes = 0;
+  }
+
+private:
+  std::uint32_t getIndex(AST ast) const {
+    assert(ast && ast.getContext() == context &&
+           "Node does not belong to the context of the set");
+    return ast.getImpl()->getIndex();
+  }
+
+  ASTContext *context;
+  llvm::BitVector bits;
+  std::size_t numNodes = 0;
+};
+
+} // namespace ast
+
+#endif // AST_NODE_SET_H
@@ -0,0 +1,55 @@
+#ifndef AST_PARALLEL_H
+#define AST_PARALLEL_H
+
+#include "ast/AST.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+
+namespace ast {
+
+/// Structural equality and hashing of large trees on a thread pool.
+///
+/// The trees are split at subtree boundaries, breadth first, until there are
+/// a few tasks per thread. Subtrees whose summary (see
+/// ASTContext::EnableSummaries) says they are smaller than the minimum
+/// subtree size are not split further. Each task runs the sequential
+/// algorithm on its subtrees; a mismatch found by one task cancels the
+/// others. The results are the same as those of AST::isEqual and AST::hash.
+class ASTParallel {
+public:
+  explicit ASTParallel(llvm::ThreadPool &pool) : pool(pool) {}
+
+  void setMinSubtreeSize(std::uint32_t size) { minSubtreeSize = size; }
+  void setTasksPerThread(unsigned count) { tasksPerThread = count; }
+
+  bool isEqual(AST lhs, AST rhs);
+  llvm::hash_code hash(AST ast);
+
+  /// Number of tasks run by the last call.
+  std::size_t getNumTasks() const { return numTasks; }
+
+private:
+  bool isSmall(AST ast) const {
+    return ast.hasSummary() && ast.getSubtreeSize() < minSubtreeSize;
+  }
+  std::size_t getMaxTasks() const {
+    return std::max(1u, pool.getThreadCount() * tasksPerThread);
+  }
+
+  llvm::ThreadPool &pool;
+  std::uint32_t minSubtreeSize = 1024;
+  unsigned tasksPerThread = 4;
+  std::size_t numTasks = 0;
+};
+
+namespace detail {
+/// AST::hash, reusing and filling the hashes of `memo`.
+llvm::hash_code hashWithMemo(AST ast,
+                             llvm::DenseMap<ASTImpl *, llvm::hash_code> &memo);
+} // namespace detail
+
+} // namespace ast
+
+#endif // AST_PARALLEL_H
@@ -0,0 +1,138 @@
+#ifndef AST_REWRITE_H
+#define AST_REWRITE_H
+
+#include "ast/AST.h"
+#include "ast/ASTMatcher.h"
+#include "ast/ASTNodeSet.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <functional>
+#include <string>
+
+namespace ast {
+
+/// Handed to rewrite functions to build replacements in the context being
+/// rewritten.
+class ASTRewriter {
+public:
+  explicit ASTRewriter(ASTContext *context) : context(context) {}
+
+  ASTContext *getContext() const { return context; }
+
+  template <typename Class, typename... Args>
+  Class create(llvm::SMRange range, Args &&...args) {
+    return Class::create(range, context, std::forward<Args>(args)...);
+  }
+
+private:
+  ASTContext *context;
+};
+
+/// Rewrite rules: a pattern plus a function building the replacement of a
+/// matched node. The function returns null to decline the match.
+class RewritePatternSet {
+public:
+  using RewriteFn = std::function<AST(AST, ASTRewriter &)>;
+
+  struct Statistics {
+    /// Times the pattern matched.
+    unsigned numMatched = 0;
+    /// Times the rewrite function produced a replacement.
+    unsigned numApplied = 0;
+  };
+
+  template <typename Pattern>
+  unsigned add(Pattern pattern, RewriteFn rewriteFn, unsigned benefit = 1,
+               llvm::StringRef name = "") {
+    unsigned idx = patterns.add(std::move(pattern), benefit);
+    rules.push_back({name.str(), std::move(rewriteFn), {}});
+    return idx;
+  }
+
+  std::size_t size() const { return rules.size(); }
+  llvm::StringRef getName(unsigned rule) const { return rules[rule].name; }
+  const Statistics &getStatistics(unsigned rule) const {
+    return rules[rule].statistics;
+  }
+  void ClearStatistics() {
+    for (auto &rule : rules)
+      rule.statistics = {};
+  }
+
+  void print(llvm::raw_ostream &os) const;
+
+private:
+  friend class GreedyRewriteDriver;
+
+  struct Rule {
+    std::string name;
+    RewriteFn rewriteFn;
+    Statistics statistics;
+  };
+
+  match::PatternSet patterns;
+  llvm::SmallVector<Rule> rules;
+};
+
+/// Applies a RewritePatternSet to a tree until no rule applies.
+///
+/// Every node of the tree is queued once, children before parents. When a
+/// node is replaced, its parents are updated in place and queued again
+/// together with the new nodes of the replacement, so only the neighborhood
+/// of a change is revisited. A rule that updates a node in place may also
+/// replace its children; the new children are queued and the dropped ones
+/// detached. Nodes of other contexts, such as replacements built elsewhere,
+/// are tracked by address.
+class GreedyRewriteDriver {
+public:
+  GreedyRewriteDriver(ASTContext *context, RewritePatternSet &patterns)
+      : context(context), patterns(patterns), rewriter(context),
+        queued(context) {}
+
+  /// Stop after this many rewrites; zero means no limit.
+  void setMaxRewrites(unsigned limit) { maxRewrites = limit; }
+
+  /// Rewrite `root` in place to a fixpoint and return the new root.
+  AST Rewrite(AST root);
+
+  /// False if the last Rewrite stopped at the rewrite limit. The counters
+  /// below also refer to the last Rewrite.
+  bool isConverged() const { return converged; }
+  unsigned getNumVisited() const { return numVisited; }
+  unsigned getNumRewrites() const { return numRewrites; }
+
+private:
+  void enqueue(AST ast);
+  void dequeue(AST ast);
+  /// Returns true if `ast` is new or was detached, so its subtree is not
+  /// linked yet.
+  bool attach(AST ast);
+  void addTree(AST ast);
+  bool isDetached(AST ast) const;
+  bool applyRules(AST ast);
+  /// Link the children of `ast` after an in-place update, given its children
+  /// `before` the update.
+  void updateChildren(AST ast, llvm::SmallVectorImpl<AST> &before);
+  void replace(AST from, AST to);
+  void detach(AST ast);
+
+  ASTContext *context;
+  RewritePatternSet &patterns;
+  ASTRewriter rewriter;
+  unsigned maxRewrites = 0;
+
+  AST root;
+  llvm::DenseMap<ASTImpl *, llvm::SmallVector<ASTImpl *, 1>> parents;
+  llvm::SmallVector<AST> worklist;
+  ASTNodeSet queued;
+  llvm::DenseSet<ASTImpl *> foreignQueued;
+  bool converged = true;
+  unsigned numVisited = 0;
+  unsigned numRewrites = 0;
+};
+
+} // namespace ast
+
+#endif // AST_REWRITE_H
@@ -0,0 +1,63 @@
+#ifndef AST_SET_REGISTRY_H
+#define AST_SET_REGISTRY_H
+
+#include "ast/ASTContext.h"
+#include <atomic>
+
+namespace ast {
+
+/// A kind table that can be shared by many ASTContexts.
+///
+/// AST sets are registered once into the registry, which is then frozen with
+/// Freeze before the first ASTContext is created from it. After that the kind
+/// table is immutable and every context created from the registry points at
+/// the same ASTKindProperty objects, so creating a context does not depend on
+/// the number of registered kinds. Contexts may be created from a frozen
+/// registry on any thread. GetOrRegisterASTSet on such a context returns a set
+/// object of its own, whose getContext() is that context.
+class ASTSetRegistry {
+public:
+  ASTSetRegistry() = default;
+
+  ASTSetRegistry(const ASTSetRegistry &) = delete;
+  ASTSetRegistry &operator=(const ASTSetRegistry &) = delete;
+  ASTSetRegistry(ASTSetRegistry &&) = delete;
+  ASTSetRegistry &operator=(ASTSetRegistry &&) = delete;
+
+  template <typename Set> ASTSetRegistry &RegisterASTSet() {
+    assert(!isFrozen() && "ASTSetRegistry is already frozen");
+    context.GetOrRegisterASTSet<Set>();
+    return *this;
+  }
+
+  void Freeze() { frozen.store(true, std::memory_order_release); }
+  bool isFrozen() const { return frozen.load(std::memory_order_acquire); }
+
+  ASTKindProperty *GetASTKindProperty(ID id) {
+    return context.GetASTKindProperty(id);
+  }
+
+  /// Returns the process-wide frozen registry holding `Sets`.
+  template <typename... Sets> static ASTSetRegistry &get() {
+    struct Holder {
+      Holder() {
+        (registry.RegisterASTSet<Sets>(), ...);
+        registry.Freeze();
+      }
+      ASTSetRegistry registry;
+    };
+    static Holder holder;
+    return holder.registry;
+  }
+
+private:
+  friend class ASTContext;
+
+  /// Owns the kind table. Nodes are never created in it.
+  ASTContext context;
+  std::atomic<bool> frozen{false};
+};
+
+} // namespace ast
+
+#endif // AST_SET_REGISTRY_H
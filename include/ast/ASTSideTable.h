@@ -0,0 +1,152 @@
+#ifndef AST_SIDE_TABLE_H
+#define AST_SIDE_TABLE_H
+
+#include "ast/AST.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <optional>
+
+namespace ast {
+
+class ASTSideTableBase {
+public:
+  virtual ~ASTSideTableBase() = default;
+
+  /// Drop every cached value.
+  virtual void clear() = 0;
+
+  /// Drop the cached values of the nodes satisfying `pred`.
+  virtual void eraseIf(llvm::function_ref<bool(const ASTImpl *)> pred) = 0;
+
+  /// Drop the cached value of `node`, which was mutated in place.
+  virtual void erase(const ASTImpl *node) = 0;
+
+  /// Move the cached value of each node of the owning context to the node
+  /// `map` returns for it, dropping it if that is null. Values of nodes of
+  /// other contexts stay as they are.
+  virtual void remap(llvm::function_ref<ASTImpl *(const ASTImpl *)> map) = 0;
+};
+
+/// A per-node attribute store with lazy computation.
+///
+/// ConcreteType provides `ValueType compute(AST ast)`, which may query the
+/// table for other nodes (e.g. children), and a constructor taking the owning
+/// ASTContext. A value is computed on the first query and cached until the
+/// node is mutated in place, which the owning context reports to its tables.
+/// Mutations of descendants are only reported while the context records
+/// parent links, i.e. while it tracks changes or computes summaries;
+/// otherwise values computed from descendants must be invalidated by hand.
+/// Nodes of other contexts are not reported either. Values are stored inline
+/// in a vector indexed by node index, so a reference returned by `get` is
+/// only valid until the next query. Nodes of other contexts are keyed by
+/// address.
+template <typename ConcreteType, typename ValueType>
+class ASTSideTable : public ASTSideTableBase {
+public:
+  using Base = ASTSideTable<ConcreteType, ValueType>;
+
+  explicit ASTSideTable(ASTContext *context) : context(context) {}
+
+  ASTContext *getContext() const { return context; }
+
+  const ValueType &get(AST ast) {
+    if (const Entry *entry = find(ast))
+      return entry->value;
+    // computing the value may query the table and move its entries
+    ValueType value = derived()->compute(ast);
+    return store(ast, std::move(value)).value;
+  }
+
+  /// Returns the cached value of `ast` if it is present.
+  const ValueType *lookup(AST ast) const {
+    const Entry *entry = find(ast);
+    return entry ? &entry->value : nullptr;
+  }
+
+  void invalidate(AST ast) {
+    if (ast.getContext() != context) {
+      foreignEntries.erase(ast.getImpl());
+      return;
+    }
+    auto idx = ast.getIndex();
+    if (idx < entries.size())
+      entries[idx].reset();
+  }
+
+  void erase(const ASTImpl *node) override { invalidate(AST(node)); }
+
+  void clear() override {
+    entries.clear();
+    foreignEntries.clear();
+  }
+
+  void eraseIf(llvm::function_ref<bool(const ASTImpl *)> pred) override {
+    for (auto &entry : entries)
+      if (entry && pred(entry->node))
+        entry.reset();
+    llvm::SmallVector<ASTImpl *> erased;
+    for (const auto &[node, entry] : foreignEntries)
+      if (pred(node))
+        erased.push_back(node);
+    for (ASTImpl *node : erased)
+      foreignEntries.erase(node);
+  }
+
+  void remap(llvm::function_ref<ASTImpl *(const ASTImpl *)> map) override {
+    llvm::SmallVector<std::optional<Entry>, 0> remapped;
+    for (auto &entry : entries) {
+      if (!entry)
+        continue;
+      ASTImpl *node = map(entry->node);
+      if (!node)
+        continue;
+      auto idx = node->getIndex();
+      if (idx >= remapped.size())
+        remapped.resize(std::max<std::size_t>(idx + 1,
+                                              context->getNumNodeIndices()));
+      remapped[idx].emplace(Entry{node, std::move(entry->value)});
+    }
+    entries = std::move(remapped);
+  }
+
+private:
+  struct Entry {
+    ASTImpl *node;
+    ValueType value;
+  };
+
+  ConcreteType *derived() { return static_cast<ConcreteType *>(this); }
+
+  const Entry *find(AST ast) const {
+    if (ast.getContext() != context) {
+      auto it = foreignEntries.find(ast.getImpl());
+      return it == foreignEntries.end() ? nullptr : &it->second;
+    }
+    auto idx = ast.getIndex();
+    return idx < entries.size() && entries[idx] ? &*entries[idx] : nullptr;
+  }
+
+  Entry &store(AST ast, ValueType value) {
+    Entry entry{ast.getImpl(), std::move(value)};
+    if (ast.getContext() != context) {
+      foreignEntries.erase(ast.getImpl());
+      return foreignEntries.try_emplace(ast.getImpl(), std::move(entry))
+          .first->second;
+    }
+    auto idx = ast.getIndex();
+    if (idx >= entries.size())
+      entries.resize(std::max<std::size_t>(idx + 1,
+                                           context->getNumNodeIndices()));
+    return entries[idx].emplace(std::move(entry));
+  }
+
+  ASTContext *const context;
+  llvm::SmallVector<std::optional<Entry>, 0> entries;
+  llvm::DenseMap<ASTImpl *, Entry> foreignEntries;
+};
+
+} // namespace ast
+
+#endif // AST_SIDE_TABLE_H
@@ -1,13 +1,19 @@
 #ifndef AST_WALKER_H
 #define AST_WALKER_H
 
+#include "ast/ASTTypeID.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include <functional>
+#include <optional>
 
 namespace ast {
 
 class AST;
+class ASTContext;
 
 class WalkResult {
 public:
@@ -47,14 +53,81 @@ public:
     functions.emplace_back(std::forward<Fn>(fn));
   }
 
+  /// Only enter ASTs that may contain one of `kinds`, as told by their kind
+  /// property or their subtree summary. The functions still see every AST
+  /// that is entered. The kinds are folded into one kind mask per context,
+  /// so the test per AST is a mask intersection.
+  void setKindFilter(llvm::ArrayRef<ID> kinds) {
+    kindFilter.assign(kinds.begin(), kinds.end());
+  }
+
   WalkResult Walk(AST ast);
 
 private:
   WalkResult walkChildren(AST ast);
+  bool mayContainFilteredKind(AST ast);
+  std::optional<WalkResult> lookupVisited(AST ast) const;
+  WalkResult setVisited(AST ast, WalkResult result);
 
   WalkOrder order;
   llvm::SmallVector<std::function<WalkResult(AST)>> functions;
+  /// Results of the walked ASTs, keyed by address for small walks and for
+  /// other contexts, and indexed by node index for the context of the first
+  /// one past that.
+  ASTContext *visitedContext = nullptr;
+  llvm::SmallVector<std::optional<WalkResult>, 0> visitedByIndex;
   llvm::DenseMap<void *, WalkResult> visited;
+  llvm::SmallVector<ID, 4> kindFilter;
+  /// Kind mask of the filter in the context it was last computed for.
+  ASTContext *filterMaskContext = nullptr;
+  std::uint64_t filterMask = 0;
+};
+
+/// Runs several independent passes in one traversal of a tree.
+///
+/// Each pass has an optional pre-visit hook, called before the children of a
+/// node, and an optional post-visit hook, called after them. The results of a
+/// pass only affect that pass: skip from its pre-visit hook hides the
+/// children of the node from it, and interrupt from either hook stops it. A
+/// subtree is entered only while some pass still wants to see it. Each pass
+/// visits a shared subtree once, at its first occurrence for that pass.
+class ASTFusedWalker {
+public:
+  using HookFn = std::function<WalkResult(AST)>;
+
+  /// Returns the index of the pass.
+  unsigned addPass(HookFn preVisit, HookFn postVisit = nullptr) {
+    passes.push_back({std::move(preVisit), std::move(postVisit)});
+    return passes.size() - 1;
+  }
+
+  std::size_t getNumPasses() const { return passes.size(); }
+
+  void Walk(AST ast);
+
+  /// True if the pass was interrupted during the last walk.
+  bool isInterrupted(unsigned pass) const { return interrupted[pass]; }
+
+private:
+  struct Pass {
+    HookFn preVisit;
+    HookFn postVisit;
+  };
+
+  void walkNode(AST ast, llvm::ArrayRef<unsigned> active);
+
+  /// Returns true if `pass` had not visited `ast` yet.
+  bool markVisited(unsigned pass, AST ast);
+
+  llvm::SmallVector<Pass> passes;
+  llvm::SmallVector<bool> interrupted;
+  /// Context of the root of the current walk.
+  ASTContext *context = nullptr;
+  /// ASTs of `context` visited by each pass during the current walk, by node
+  /// index.
+  llvm::SmallVector<llvm::BitVector> visited;
+  /// ASTs of other contexts visited by each pass, by address.
+  llvm::SmallVector<llvm::DenseSet<void *>> foreignVisited;
 };
 
 } // namespace ast
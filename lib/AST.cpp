@@ -1,8 +1,164 @@
 #include "ast/AST.h"
+#include "ast/ASTCloner.h"
+#include "ast/ASTParallel.h"
 #include "ast/ASTVisitor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include <algorithm>
+#include <limits>
 
 namespace ast {
 
+AST AST::clone(ASTContext *ctx) const { return ASTCloner(ctx).clone(*this); }
+
+llvm::hash_code
+detail::hashWithMemo(AST ast,
+                     llvm::DenseMap<ASTImpl *, llvm::hash_code> &memo) {
+  if (!ast)
+    return llvm::hash_code(0);
+  if (auto it = memo.find(ast.getImpl()); it != memo.end())
+    return it->second;
+  auto hash = ast.getASTKindProperty().getHashFn()(
+      ast, [&](AST child) { return hashWithMemo(child, memo); });
+  memo.try_emplace(ast.getImpl(), hash);
+  return hash;
+}
+
+llvm::hash_code AST::hash() const {
+  llvm::DenseMap<ASTImpl *, llvm::hash_code> memo;
+  return detail::hashWithMemo(*this, memo);
+}
+
+static bool
+isEqualImpl(AST lhs, AST rhs,
+            llvm::DenseSet<std::pair<ASTImpl *, ASTImpl *>> &memo) {
+  if (lhs == rhs)
+    return true;
+  if (!lhs || !rhs)
+    return false;
+  if (memo.contains({lhs.getImpl(), rhs.getImpl()}))
+    return true;
+  // A mismatch ends the whole comparison, so only equal pairs are kept.
+  if (!lhs.getASTKindProperty().getEqualFn()(
+          lhs, rhs, [&](AST lhsChild, AST rhsChild) {
+            return isEqualImpl(lhsChild, rhsChild, memo);
+          }))
+    return false;
+  memo.insert({lhs.getImpl(), rhs.getImpl()});
+  return true;
+}
+
+bool AST::isEqualMemoized(const AST other) const {
+  llvm::DenseSet<std::pair<ASTImpl *, ASTImpl *>> memo;
+  return isEqualImpl(*this, other, memo);
+}
+
+void AST::setChild(std::size_t idx, AST child) const {
+  ASTBuilder::setChild(*this, idx, child);
+}
+
+void ASTBuilder::setChild(AST ast, std::size_t idx, AST child) {
+  const auto &property = ast.getASTKindProperty();
+  if (!property.hasFixedChildren()) {
+    std::size_t count = 0;
+    ast.remapChildren(
+        [&](AST current) { return count++ == idx ? child : current; });
+    assert(count > idx && "Invalid child index");
+    return;
+  }
+
+  assert(idx < property.getChildOffsets().size() && "Invalid child index");
+  AST *slot = ast.getChildSlot(property.getChildOffsets()[idx]);
+  AST old = *slot;
+  *slot = child;
+  ASTImpl *impl = ast.getImpl();
+  impl->markModified();
+  assert(hasAllowedChildren(impl) &&
+         "Child kind not allowed by the ASTTypeOf bounds of its parent");
+  ASTContext *ctx = impl->getContext();
+  if (ctx && ctx->isRecordingParents()) {
+    if (old)
+      updateParents(impl, old.getImpl());
+    else if (child)
+      ctx->recordParent(child.getImpl(), impl);
+  }
+  refreshSummaries(impl);
+}
+
+void ASTBuilder::updateParents(ASTImpl *impl,
+                               llvm::ArrayRef<ASTImpl *> oldChildren) {
+  ASTContext *ctx = impl->getContext();
+  llvm::SmallPtrSet<ASTImpl *, 8> children;
+  AST(impl).walkChildren([&](AST child) {
+    if (child && children.insert(child.getImpl()).second)
+      ctx->recordParent(child.getImpl(), impl);
+  });
+  for (ASTImpl *oldChild : oldChildren)
+    if (!children.contains(oldChild))
+      ctx->eraseParent(oldChild, impl);
+}
+
+bool ASTBuilder::summarize(ASTImpl *impl) {
+  ASTContext *ctx = impl->getContext();
+  std::uint64_t size = 1;
+  unsigned height = 0;
+  std::uint64_t kindMask = 0;
+  bool complete = true;
+  AST(impl).walkChildren([&](AST child) {
+    if (!child)
+      return;
+    ASTImpl *childImpl = child.getImpl();
+    if (childImpl->getContext() != ctx || !childImpl->hasSummary()) {
+      complete = false;
+      return;
+    }
+    auto childSummary = childImpl->getSummary();
+    size += childSummary.subtreeSize;
+    height = std::max<unsigned>(height, childSummary.height + 1);
+    kindMask |= childSummary.descendantKindMask |
+                childImpl->getProperty()->getKindMask();
+  });
+  if (!complete)
+    size = height = kindMask = 0;
+
+  ASTContext::NodeSummary summary;
+  summary.subtreeSize = static_cast<std::uint32_t>(
+      std::min<std::uint64_t>(size, std::numeric_limits<std::uint32_t>::max()));
+  summary.descendantKindMask = kindMask;
+  summary.height = static_cast<std::uint16_t>(
+      std::min<unsigned>(height, std::numeric_limits<std::uint16_t>::max()));
+
+  auto old = impl->getSummary();
+  if (old.subtreeSize == summary.subtreeSize && old.height == summary.height &&
+      old.descendantKindMask == summary.descendantKindMask)
+    return false;
+  auto idx = impl->getIndex();
+  auto &summaries = ctx->summaries;
+  if (idx >= summaries.size())
+    summaries.resize(idx + 1);
+  summaries[idx] = summary;
+  return true;
+}
+
+bool ASTBuilder::hasAllowedChildren(ASTImpl *impl) {
+  const ASTKindProperty *property = impl->getProperty();
+  bool allowed = true;
+  AST(impl).walkChildren([&](AST child) {
+    if (child && !property->mayContain(child.getASTKindProperty().getID()))
+      allowed = false;
+  });
+  return allowed;
+}
+
+void ASTBuilder::markModified(ASTImpl *impl) { impl->markModified(); }
+
+void ASTBuilder::refreshSummaries(ASTImpl *impl) {
+  ASTContext *ctx = impl->getContext();
+  if (ctx && ctx->isComputingSummaries())
+    ctx->refreshSummaries(impl);
+}
+
 void AST::accept(Visitor &visitor) const { visitor.visit(*this); }
 
 std::string AST::toString() const {
@@ -0,0 +1,65 @@
+#include "ast/ASTCloner.h"
+#include "ast/AST.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace ast {
+
+AST ASTCloner::clone(AST ast) {
+  reserve(ast);
+  return cloneNode(ast);
+}
+
+void ASTCloner::clone(llvm::ArrayRef<AST> roots,
+                      llvm::SmallVectorImpl<AST> &cloned) {
+  reserve(roots);
+  cloned.reserve(cloned.size() + roots.size());
+  for (AST root : roots)
+    cloned.push_back(cloneNode(root));
+}
+
+AST ASTCloner::cloneNode(AST ast) {
+  if (!ast)
+    return ast;
+  if (auto cloned = lookup(ast))
+    return cloned;
+
+  AST cloned = ast.getASTKindProperty().getCloneFn()(ast, *this);
+  remap.try_emplace(ast.getImpl(), cloned.getImpl());
+  return cloned;
+}
+
+AST ASTCloner::lookup(AST ast) const {
+  auto it = remap.find(ast.getImpl());
+  if (it == remap.end())
+    return AST();
+  return AST(it->second);
+}
+
+void ASTCloner::reserve(llvm::ArrayRef<AST> roots) {
+  std::size_t size = 0;
+  std::size_t count = 0;
+  llvm::DenseSet<ASTImpl *> seen;
+  llvm::SmallVector<AST> worklist;
+  for (AST root : roots)
+    if (root && !lookup(root) && seen.insert(root.getImpl()).second)
+      worklist.push_back(root);
+  if (worklist.empty())
+    return;
+
+  while (!worklist.empty()) {
+    AST node = worklist.pop_back_val();
+    const auto &property = node.getASTKindProperty();
+    size += llvm::alignTo(property.getImplSize(), property.getImplAlign());
+    ++count;
+
+    node.walkChildren([&](AST child) {
+      if (child && !lookup(child) && seen.insert(child.getImpl()).second)
+        worklist.push_back(child);
+    });
+  }
+
+  context->Reserve(size, count);
+}
+
+} // namespace ast
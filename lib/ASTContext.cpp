@@ -1,20 +1,32 @@
 #include "ast/ASTContext.h"
+#include "ast/AST.h"
+#include "ast/ASTCloner.h"
 #include "ast/ASTKindProperty.h"
 #include "ast/ASTSet.h"
+#include "ast/ASTSetRegistry.h"
+#include "ast/ASTSideTable.h"
 #include "ast/ASTTypeID.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <utility>
 
 namespace ast {
 
-class ASTContextImpl {
+/// Table of the registered AST kinds and AST sets. A table is either owned by
+/// a single ASTContext or shared, read-only, by every context created from the
+/// same ASTSetRegistry.
+class ASTKindTable {
 public:
-  ~ASTContextImpl() {
-    for (auto &[ptr, destructor] : destructors)
-      destructor(ptr);
+  ~ASTKindTable() {
+    for (auto &[id, property] : propertiesMap)
+      property->~ASTKindProperty();
   }
 
-  ASTKindProperty *getASTKindProperty(ID id) {
+  ASTKindProperty *getASTKindProperty(ID id) const {
     auto it = propertiesMap.find(id);
     if (it == propertiesMap.end())
       return nullptr;
@@ -24,22 +36,40 @@ public:
   void registerAST(ID id, ASTKindProperty &&property) {
     auto *newProperty = allocator.Allocate<ASTKindProperty>();
     new (newProperty) ASTKindProperty(std::move(property));
+    // Bits are reused past 64 kinds; masks then over-approximate, which only
+    // costs walks some subtrees they could have skipped.
+    constexpr unsigned numMaskBits = 8 * sizeof(ASTKindProperty::KindMask);
+    newProperty->kindMask = ASTKindProperty::KindMask(1)
+                            << (propertiesMap.size() % numMaskBits);
+
+    // Descendant kinds may be registered before or after the kinds that
+    // contain them.
+    if (newProperty->boundedDescendants) {
+      newProperty->mayContainMask = 0;
+      for (ID kind : newProperty->descendantKinds)
+        if (auto *descendant = getASTKindProperty(kind))
+          newProperty->mayContainMask |= descendant->kindMask;
+    }
+    for (auto &[otherID, other] : propertiesMap)
+      if (other->boundedDescendants && other->mayContain(id))
+        other->mayContainMask |= newProperty->kindMask;
+
     auto [it, unique] = propertiesMap.try_emplace(id, newProperty);
     (void)unique;
     assert(unique && "ASTKindProperty already registered");
   }
 
-  void *alloc(std::size_t size, std::size_t align, void (*destructor)(void *)) {
-    void *ptr = allocator.Allocate(size, align);
-    destructors.emplace_back(ptr, destructor);
-    return ptr;
+  ASTSet *getASTSet(ID id) const {
+    auto it = astSetMap.find(id);
+    if (it == astSetMap.end())
+      return nullptr;
+    return it->second.get();
   }
 
-  void *getASTSet(ID id, ASTContext *ctx, ASTContext::AllocSetFn fn) {
-    auto [it, inserted] = astSetMap.try_emplace(id, nullptr);
-    if (!inserted)
-      return it->second.get();
-    it->second = fn(ctx);
+  ASTSet *registerASTSet(ID id, std::unique_ptr<ASTSet> set) {
+    auto [it, inserted] = astSetMap.try_emplace(id, std::move(set));
+    (void)inserted;
+    assert(inserted && "ASTSet already registered");
     it->second->RegisterSet();
     return it->second.get();
   }
@@ -48,12 +78,235 @@ private:
   llvm::BumpPtrAllocator allocator;
   llvm::DenseMap<ID, ASTKindProperty *> propertiesMap;
   llvm::DenseMap<ID, std::unique_ptr<ASTSet>> astSetMap;
+};
+
+/// The memory holding the nodes of a context. Destroying it runs the
+/// destructors of the nodes that have one and releases the slabs.
+class ASTArena {
+public:
+  ~ASTArena() {
+    for (auto &[ptr, destructor] : destructors)
+      destructor(ptr);
+  }
+
+  void *alloc(std::size_t size, std::size_t align, void (*destructor)(void *)) {
+    void *ptr = allocReserved(size, align);
+    if (!ptr)
+      ptr = allocator.Allocate(size, align);
+    if (destructor)
+      destructors.emplace_back(ptr, destructor);
+    return ptr;
+  }
+
+  /// Like alloc for memory that is not a node, leaving any reserved block
+  /// to the nodes.
+  void *allocUnreserved(std::size_t size, std::size_t align) {
+    return allocator.Allocate(size, align);
+  }
+
+  /// Forget the destructors of the objects satisfying `pred`, which were
+  /// moved out of this arena and must not be destroyed with it.
+  void eraseDestructorsIf(llvm::function_ref<bool(void *)> pred) {
+    llvm::erase_if(destructors,
+                   [&](const auto &entry) { return pred(entry.first); });
+  }
+
+  bool contains(const void *ptr) {
+    return static_cast<bool>(allocator.identifyObject(ptr));
+  }
+
+  /// Nodes created in this arena, only recorded while regions are checked.
+  void recordNode(ASTImpl *node) { nodes.push_back(node); }
+  llvm::ArrayRef<ASTImpl *> getNodes() const { return nodes; }
 
+  void reserve(std::size_t size, std::size_t numObjects) {
+    destructors.reserve(destructors.size() + numObjects);
+    if (size == 0)
+      return;
+    reservedBegin = static_cast<char *>(
+        allocator.Allocate(size, alignof(std::max_align_t)));
+    reservedEnd = reservedBegin + size;
+  }
+
+  std::size_t getAllocatedBytes() const { return allocator.getTotalMemory(); }
+
+private:
+  void *allocReserved(std::size_t size, std::size_t align) {
+    if (!reservedBegin)
+      return nullptr;
+    std::uintptr_t ptr = llvm::alignAddr(reservedBegin, llvm::Align(align));
+    if (ptr + size > reinterpret_cast<std::uintptr_t>(reservedEnd))
+      return nullptr;
+    reservedBegin = reinterpret_cast<char *>(ptr + size);
+    return reinterpret_cast<void *>(ptr);
+  }
+
+  llvm::BumpPtrAllocator allocator;
+  char *reservedBegin = nullptr;
+  char *reservedEnd = nullptr;
   llvm::SmallVector<std::pair<void *, void (*)(void *)>> destructors;
+  llvm::SmallVector<ASTImpl *> nodes;
+};
+
+class ASTContextImpl {
+public:
+  ASTContextImpl()
+      : ownedKinds(std::make_unique<ASTKindTable>()), kinds(ownedKinds.get()) {
+    pushArena();
+  }
+  explicit ASTContextImpl(const ASTKindTable *sharedKinds)
+      : kinds(sharedKinds) {
+    pushArena();
+  }
+
+  bool isShared() const { return !ownedKinds; }
+  const ASTKindTable *getKindTable() const { return kinds; }
+
+  ASTKindProperty *getASTKindProperty(ID id) {
+    return kinds->getASTKindProperty(id);
+  }
+
+  void registerAST(ID id, ASTKindProperty &&property) {
+    assert(!isShared() &&
+           "AST kinds cannot be registered into a frozen ASTSetRegistry");
+    ownedKinds->registerAST(id, std::move(property));
+  }
+
+  void *alloc(std::size_t size, std::size_t align, void (*destructor)(void *)) {
+    return arenas.back()->alloc(size, align, destructor);
+  }
+
+  void reserve(std::size_t size, std::size_t numObjects) {
+    arenas.back()->reserve(size, numObjects);
+  }
+
+  std::size_t getAllocatedBytes() const {
+    std::size_t bytes = 0;
+    for (const auto &arena : arenas)
+      bytes += arena->getAllocatedBytes();
+    return bytes;
+  }
+
+  /// Start allocating from a fresh arena and return the current one. The
+  /// parent links refer to the old nodes and are dropped; they are recorded
+  /// again for the nodes moved out of the old arena.
+  std::unique_ptr<ASTArena> takeArena() {
+    assert(arenas.size() == 1 && "Cannot collect while a region is active");
+    auto oldArena = std::exchange(arenas.front(), std::make_unique<ASTArena>());
+    parents.clear();
+    return oldArena;
+  }
+
+  void remapSideTables(llvm::function_ref<ASTImpl *(const ASTImpl *)> map) {
+    for (auto &[id, table] : sideTables)
+      table->remap(map);
+  }
+
+  ASTArena *pushArena() {
+    return arenas.emplace_back(std::make_unique<ASTArena>()).get();
+  }
+
+  /// Destroy the innermost arena, which must be `arena`, and drop the node
+  /// keyed state of its nodes, which are numbered from `firstIndex` on.
+  void popArena(ASTArena *arena, bool checked, std::uint32_t firstIndex) {
+    assert(arenas.size() > 1 && arenas.back().get() == arena &&
+           "Regions must be exited in reverse order of entry");
+    auto isDead = [arena](const ASTImpl *node) {
+      return arena->contains(node);
+    };
+
+    if (checked)
+      for (std::size_t i = 0; i + 1 < arenas.size(); ++i)
+        for (ASTImpl *node : arenas[i]->getNodes())
+          AST(node).walkChildren([&](AST child) {
+            if (child && isDead(child.getImpl()))
+              llvm::report_fatal_error(
+                  "AST node outside a region points to a node in it");
+          });
+
+    for (auto &[id, table] : sideTables)
+      table->eraseIf(isDead);
+    if (parents.size() > firstIndex)
+      parents.truncate(firstIndex);
+    for (auto &childParents : parents)
+      llvm::erase_if(childParents, [firstIndex](const ASTImpl *parent) {
+        return parent->getIndex() >= firstIndex;
+      });
+    arenas.pop_back();
+  }
+
+  void recordNode(ASTImpl *node) { arenas.back()->recordNode(node); }
+
+  /// A shared kind table already holds the kinds of its sets, so a context
+  /// sharing it only creates its own set object, bound to itself.
+  void *getASTSet(ID id, ASTContext *ctx, ASTContext::AllocSetFn fn) {
+    if (!isShared()) {
+      if (auto *set = ownedKinds->getASTSet(id))
+        return set;
+      return ownedKinds->registerASTSet(id, fn(ctx));
+    }
+    assert(kinds->getASTSet(id) &&
+           "ASTSet is not registered in the frozen ASTSetRegistry");
+    auto [it, inserted] = sharedSets.try_emplace(id, nullptr);
+    if (inserted)
+      it->second = fn(ctx);
+    return it->second.get();
+  }
+
+  void *getSideTable(ID id, ASTContext *ctx, ASTContext::AllocSideTableFn fn) {
+    auto [it, inserted] = sideTables.try_emplace(id, nullptr);
+    if (inserted)
+      it->second = fn(ctx);
+    return it->second.get();
+  }
+
+  void recordParent(ASTImpl *child, ASTImpl *parent) {
+    auto idx = child->getIndex();
+    if (idx >= parents.size())
+      parents.resize(idx + 1);
+    auto &childParents = parents[idx];
+    if (!llvm::is_contained(childParents, parent))
+      childParents.push_back(parent);
+  }
+
+  void eraseParent(ASTImpl *child, ASTImpl *parent) {
+    auto idx = child->getIndex();
+    if (idx < parents.size())
+      llvm::erase_value(parents[idx], parent);
+  }
+
+  llvm::ArrayRef<ASTImpl *> getParents(ASTImpl *child) const {
+    auto idx = child->getIndex();
+    if (idx >= parents.size())
+      return {};
+    return parents[idx];
+  }
+
+  void invalidateSideTables(ASTImpl *node) {
+    for (auto &[id, table] : sideTables)
+      table->erase(node);
+  }
+
+private:
+  std::unique_ptr<ASTKindTable> ownedKinds;
+  const ASTKindTable *kinds;
+  /// Set objects of a context sharing its kind table.
+  llvm::DenseMap<ID, std::unique_ptr<ASTSet>> sharedSets;
+
+  /// The context arena followed by the arenas of the active regions.
+  llvm::SmallVector<std::unique_ptr<ASTArena>, 1> arenas;
+  llvm::DenseMap<ID, std::unique_ptr<ASTSideTableBase>> sideTables;
+
+  /// Parents of the nodes of this context by node index.
+  llvm::SmallVector<llvm::TinyPtrVector<ASTImpl *>, 0> parents;
 };
 
 ASTContext::ASTContext() : impl(new ASTContextImpl()) {}
-ASTContext::ASTContext(ASTSetRegistry &registry) : impl(new ASTContextImpl()) {}
+ASTContext::ASTContext(ASTSetRegistry &registry) {
+  assert(registry.isFrozen() &&
+         "ASTSetRegistry must be frozen before contexts are created from it");
+  impl = new ASTContextImpl(registry.context.impl->getKindTable());
+}
 
 ASTContext::~ASTContext() { delete impl; }
 
@@ -66,12 +319,144 @@ void *ASTContext::allocImpl(std::size_t size, std::size_t align,
   return impl->alloc(size, align, destructor);
 }
 
+void ASTContext::Reserve(std::size_t size, std::size_t numObjects) {
+  impl->reserve(size, numObjects);
+}
+
 void *ASTContext::getOrRegisterASTSetImpl(ID id, AllocSetFn fn) {
   return impl->getASTSet(id, this, fn);
 }
 
+void *ASTContext::getOrCreateSideTableImpl(ID id, AllocSideTableFn fn) {
+  hasSideTables = true;
+  return impl->getSideTable(id, this, fn);
+}
+
 ASTKindProperty *ASTContext::GetASTKindProperty(ID id) {
   return impl->getASTKindProperty(id);
 }
 
+bool ASTContext::isSharingKinds() const { return impl->isShared(); }
+
+static void setNodeBit(llvm::BitVector &bits, std::uint32_t idx) {
+  if (idx >= bits.size())
+    bits.resize(std::max<std::size_t>(idx + 1, 2 * bits.size()));
+  bits.set(idx);
+}
+
+void ASTContext::Collect(llvm::MutableArrayRef<AST> roots) {
+  assert(llvm::all_of(roots,
+                      [&](AST root) {
+                        return !root || root.getContext() == this;
+                      }) &&
+         "Roots must belong to this context");
+  auto oldArena = impl->takeArena();
+  llvm::BitVector oldDirtyNodes = std::exchange(dirtyNodes, {});
+  llvm::BitVector oldSubtreeDirtyNodes = std::exchange(subtreeDirtyNodes, {});
+  // The moved nodes are numbered from zero, and their parent links and
+  // summaries are recorded again as they are created.
+  numNodeIndices = 0;
+  summaries.clear();
+  llvm::SmallVector<AST> moved;
+  ASTCloner cloner(this);
+  cloner.EnableMoving();
+  cloner.clone(roots, moved);
+  llvm::copy(moved, roots.begin());
+
+  const auto &clones = cloner.getClones();
+  auto isSet = [](const llvm::BitVector &bits, std::uint32_t idx) {
+    return idx < bits.size() && bits.test(idx);
+  };
+  for (auto [from, to] : clones) {
+    if (isSet(oldDirtyNodes, from->getIndex()))
+      setNodeBit(dirtyNodes, to->getIndex());
+    if (isSet(oldSubtreeDirtyNodes, from->getIndex()))
+      setNodeBit(subtreeDirtyNodes, to->getIndex());
+  }
+  impl->remapSideTables([&clones](const ASTImpl *node) -> ASTImpl * {
+    return clones.lookup(const_cast<ASTImpl *>(node));
+  });
+  // Only the nodes left behind are destroyed with the old arena.
+  oldArena->eraseDestructorsIf([&clones](void *ptr) {
+    return clones.count(static_cast<ASTImpl *>(ptr));
+  });
+}
+
+std::size_t ASTContext::getAllocatedBytes() const {
+  return impl->getAllocatedBytes();
+}
+
+void ASTContext::EnableRegionChecks() { checkingRegions = true; }
+
+void ASTContext::recordNode(ASTImpl *node) { impl->recordNode(node); }
+
+ASTContext::Region::Region(ASTContext *context)
+    : context(context), arena(context->impl->pushArena()),
+      firstIndex(context->getNumNodeIndices()) {}
+
+ASTContext::Region::~Region() {
+  context->impl->popArena(arena, context->isCheckingRegions(), firstIndex);
+  // indices are not reused, so the state of the dead nodes can go
+  if (context->summaries.size() > firstIndex)
+    context->summaries.truncate(firstIndex);
+}
+
+void *ASTContext::Region::Allocate(std::size_t size, std::size_t align) {
+  return arena->allocUnreserved(size, align);
+}
+
+bool ASTContext::Region::contains(AST ast) const {
+  return ast && arena->contains(ast.getImpl());
+}
+
+std::size_t ASTContext::Region::getAllocatedBytes() const {
+  return arena->getAllocatedBytes();
+}
+
+void ASTContext::EnableChangeTracking() { trackingChanges = true; }
+
+void ASTContext::EnableSummaries() { computingSummaries = true; }
+
+void ASTContext::ClearChanges() {
+  dirtyNodes.reset();
+  subtreeDirtyNodes.reset();
+}
+
+void ASTContext::recordParent(ASTImpl *child, ASTImpl *parent) {
+  // A mutation of a node is reported to its own context only.
+  if (child->getContext() == this)
+    impl->recordParent(child, parent);
+}
+
+void ASTContext::eraseParent(ASTImpl *child, ASTImpl *parent) {
+  if (child->getContext() == this)
+    impl->eraseParent(child, parent);
+}
+
+void ASTContext::refreshSummaries(ASTImpl *modified) {
+  llvm::SmallVector<ASTImpl *> worklist{modified};
+  while (!worklist.empty()) {
+    ASTImpl *node = worklist.pop_back_val();
+    if (ASTBuilder::summarize(node))
+      llvm::append_range(worklist, impl->getParents(node));
+  }
+}
+
+void ASTContext::markModified(ASTImpl *modified) {
+  if (trackingChanges)
+    setNodeBit(dirtyNodes, modified->getIndex());
+  // The ancestors are only known while parent links are recorded.
+  llvm::SmallVector<ASTImpl *> worklist{modified};
+  llvm::SmallPtrSet<ASTImpl *, 8> visited{modified};
+  while (!worklist.empty()) {
+    ASTImpl *node = worklist.pop_back_val();
+    impl->invalidateSideTables(node);
+    if (trackingChanges)
+      setNodeBit(subtreeDirtyNodes, node->getIndex());
+    for (ASTImpl *parent : impl->getParents(node))
+      if (visited.insert(parent).second)
+        worklist.push_back(parent);
+  }
+}
+
 } // namespace ast
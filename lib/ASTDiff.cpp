@@ -0,0 +1,82 @@
+#include "ast/ASTDiff.h"
+
+namespace ast {
+
+static llvm::SmallVector<AST> collectChildren(AST ast) {
+  llvm::SmallVector<AST> children;
+  ast.walkChildren([&](AST child) { children.push_back(child); });
+  return children;
+}
+
+void ASTDiff::Diff(AST from, AST to, EditFn fn) {
+  diffNode(from, to, AST(), 0, fn);
+}
+
+llvm::SmallVector<ASTEdit> ASTDiff::Diff(AST from, AST to) {
+  llvm::SmallVector<ASTEdit> edits;
+  Diff(from, to, [&](const ASTEdit &edit) { edits.push_back(edit); });
+  return edits;
+}
+
+llvm::hash_code ASTDiff::getHash(AST ast) {
+  if (!ast)
+    return llvm::hash_code(0);
+  if (auto it = hashes.find(ast.getImpl()); it != hashes.end())
+    return it->second;
+  auto hash = ast.getASTKindProperty().getHashFn()(
+      ast, [this](AST child) { return getHash(child); });
+  hashes.try_emplace(ast.getImpl(), hash);
+  return hash;
+}
+
+bool ASTDiff::isSame(AST from, AST to) {
+  if (from == to)
+    return true;
+  if (!from || !to || getHash(from) != getHash(to))
+    return false;
+  return !verifyHashes || from.isEqual(to);
+}
+
+void ASTDiff::diffNode(AST from, AST to, AST parent, std::size_t index,
+                       EditFn fn) {
+  if (isSame(from, to))
+    return;
+
+  if (!from || !to || from.getID() != to.getID()) {
+    fn({ASTEdit::Kind::Replace, from, to, parent, index});
+    return;
+  }
+
+  bool shallowEqual = from.getASTKindProperty().getEqualFn()(
+      from, to, [](AST, AST) { return true; });
+  if (!shallowEqual)
+    fn({ASTEdit::Kind::Update, from, to, parent, index});
+  diffChildren(from, to, fn);
+}
+
+void ASTDiff::diffChildren(AST from, AST to, EditFn fn) {
+  auto fromChildren = collectChildren(from);
+  auto toChildren = collectChildren(to);
+
+  std::size_t fromEnd = fromChildren.size();
+  std::size_t toEnd = toChildren.size();
+  std::size_t begin = 0;
+  if (fromEnd != toEnd) {
+    while (begin < fromEnd && begin < toEnd &&
+           isSame(fromChildren[begin], toChildren[begin]))
+      ++begin;
+    while (fromEnd > begin && toEnd > begin &&
+           isSame(fromChildren[fromEnd - 1], toChildren[toEnd - 1]))
+      --fromEnd, --toEnd;
+  }
+
+  std::size_t paired = begin + std::min(fromEnd - begin, toEnd - begin);
+  for (std::size_t idx = begin; idx < paired; ++idx)
+    diffNode(fromChildren[idx], toChildren[idx], from, idx, fn);
+  for (std::size_t idx = paired; idx < fromEnd; ++idx)
+    fn({ASTEdit::Kind::Delete, fromChildren[idx], AST(), from, idx});
+  for (std::size_t idx = paired; idx < toEnd; ++idx)
+    fn({ASTEdit::Kind::Insert, AST(), toChildren[idx], from, idx});
+}
+
+} // namespace ast
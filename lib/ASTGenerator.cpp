@@ -0,0 +1,67 @@
+#include "ast/ASTGenerator.h"
+#include "llvm/ADT/STLExtras.h"
+
+namespace ast {
+
+ASTGenerator<AST> generatePreOrder(AST root) {
+  if (!root)
+    co_return;
+  llvm::SmallVector<detail::ASTTraversalFrame, 8> stack;
+  co_yield root;
+  stack.emplace_back(root);
+  while (!stack.empty()) {
+    AST child = stack.back().nextChild();
+    if (!child) {
+      stack.pop_back();
+      continue;
+    }
+    co_yield child;
+    stack.emplace_back(child);
+  }
+}
+
+ASTGenerator<AST> generatePostOrder(AST root) {
+  if (!root)
+    co_return;
+  llvm::SmallVector<detail::ASTTraversalFrame, 8> stack;
+  stack.emplace_back(root);
+  while (!stack.empty()) {
+    if (AST child = stack.back().nextChild()) {
+      stack.emplace_back(child);
+      continue;
+    }
+    AST node = stack.pop_back_val().node;
+    co_yield node;
+  }
+}
+
+ASTGenerator<AST> generateKinds(AST root, llvm::SmallVector<ID> kinds) {
+  auto mayContain = [&](AST ast) {
+    const auto &property = ast.getASTKindProperty();
+    return llvm::any_of(kinds,
+                        [&](ID kind) { return property.mayContain(kind); });
+  };
+
+  if (!root)
+    co_return;
+  if (llvm::is_contained(kinds, root.getID()))
+    co_yield root;
+  if (!mayContain(root))
+    co_return;
+
+  llvm::SmallVector<detail::ASTTraversalFrame, 8> stack;
+  stack.emplace_back(root);
+  while (!stack.empty()) {
+    AST child = stack.back().nextChild();
+    if (!child) {
+      stack.pop_back();
+      continue;
+    }
+    if (llvm::is_contained(kinds, child.getID()))
+      co_yield child;
+    if (mayContain(child))
+      stack.emplace_back(child);
+  }
+}
+
+} // namespace ast
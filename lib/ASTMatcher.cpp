@@ -0,0 +1,74 @@
+#include "ast/ASTMatcher.h"
+#include <algorithm>
+#include <iterator>
+
+namespace ast::match {
+
+void PatternSet::Compile() {
+  if (compiled)
+    return;
+
+  auto byBenefit = [this](unsigned lhs, unsigned rhs) {
+    return patterns[lhs].benefit > patterns[rhs].benefit;
+  };
+
+  for (unsigned idx = 0, e = patterns.size(); idx != e; ++idx) {
+    if (ID kind = patterns[idx].kind)
+      dispatch[kind].push_back(idx);
+    else
+      anyKind.push_back(idx);
+  }
+
+  llvm::stable_sort(anyKind, byBenefit);
+  for (auto &[kind, candidates] : dispatch) {
+    llvm::stable_sort(candidates, byBenefit);
+    llvm::SmallVector<unsigned> merged;
+    merged.reserve(candidates.size() + anyKind.size());
+    std::merge(candidates.begin(), candidates.end(), anyKind.begin(),
+               anyKind.end(), std::back_inserter(merged),
+               [&](unsigned lhs, unsigned rhs) {
+                 if (patterns[lhs].benefit != patterns[rhs].benefit)
+                   return byBenefit(lhs, rhs);
+                 return lhs < rhs;
+               });
+    candidates = std::move(merged);
+  }
+  compiled = true;
+}
+
+llvm::ArrayRef<unsigned> PatternSet::getCandidates(ID kind) const {
+  assert(compiled && "Expected a compiled pattern set");
+  if (auto it = dispatch.find(kind); it != dispatch.end())
+    return it->second;
+  return anyKind;
+}
+
+bool PatternSet::matchesMemberKinds(const Entry &entry, AST ast,
+                                    MemberKindCache &cache) {
+  // All candidates for a node share its root kind, so the kinds read for one
+  // candidate are valid for the others.
+  for (auto [member, kind] : entry.memberKinds) {
+    auto it = llvm::find_if(
+        cache, [member = member](const auto &cached) {
+          return cached.first == member;
+        });
+    if (it == cache.end()) {
+      cache.emplace_back(member, entry.getMemberKind(ast, member));
+      it = std::prev(cache.end());
+    }
+    if (it->second != kind)
+      return false;
+  }
+  return true;
+}
+
+std::optional<unsigned> PatternSet::match(AST ast) const {
+  std::optional<unsigned> result;
+  matchAll(ast, [&](unsigned pattern) {
+    result = pattern;
+    return false;
+  });
+  return result;
+}
+
+} // namespace ast::match
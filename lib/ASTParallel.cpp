@@ -0,0 +1,94 @@
+#include "ast/ASTParallel.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include <atomic>
+
+namespace ast {
+
+static bool isEqualUnlessCancelled(AST lhs, AST rhs,
+                                   const std::atomic<bool> &cancelled) {
+  if (lhs == rhs)
+    return true;
+  if (!lhs || !rhs || cancelled.load(std::memory_order_relaxed))
+    return false;
+  return lhs.getASTKindProperty().getEqualFn()(
+      lhs, rhs, [&](AST lhsChild, AST rhsChild) {
+        return isEqualUnlessCancelled(lhsChild, rhsChild, cancelled);
+      });
+}
+
+bool ASTParallel::isEqual(AST lhs, AST rhs) {
+  // Compare the nodes above the split shallowly, collecting the pairs of
+  // children left to compare.
+  llvm::SmallVector<std::pair<AST, AST>> pending{{lhs, rhs}};
+  llvm::SmallVector<std::pair<AST, AST>> tasks;
+  auto maxTasks = getMaxTasks();
+  for (std::size_t idx = 0; idx < pending.size(); ++idx) {
+    auto [lhs, rhs] = pending[idx];
+    if (lhs == rhs)
+      continue;
+    if (!lhs || !rhs)
+      return false;
+    if (isSmall(lhs) || tasks.size() + pending.size() - idx >= maxTasks) {
+      tasks.emplace_back(lhs, rhs);
+      continue;
+    }
+    auto collectChildren = [&](AST lhsChild, AST rhsChild) {
+      pending.emplace_back(lhsChild, rhsChild);
+      return true;
+    };
+    if (!lhs.getASTKindProperty().getEqualFn()(lhs, rhs, collectChildren))
+      return false;
+  }
+
+  numTasks = tasks.size();
+  std::atomic<bool> mismatch = false;
+  llvm::SmallVector<std::shared_future<void>> futures;
+  futures.reserve(tasks.size());
+  for (auto [lhs, rhs] : tasks)
+    futures.emplace_back(pool.async([lhs = lhs, rhs = rhs, &mismatch] {
+      if (!isEqualUnlessCancelled(lhs, rhs, mismatch))
+        mismatch.store(true, std::memory_order_relaxed);
+    }));
+  for (auto &future : futures)
+    future.wait();
+  return !mismatch;
+}
+
+llvm::hash_code ASTParallel::hash(AST ast) {
+  // Hash the subtrees below the split in parallel, then the nodes above it
+  // with their hashes known.
+  llvm::SmallVector<AST> pending{ast};
+  llvm::DenseSet<ASTImpl *> seen{ast.getImpl()};
+  llvm::SmallVector<AST> tasks;
+  auto maxTasks = getMaxTasks();
+  for (std::size_t idx = 0; idx < pending.size(); ++idx) {
+    AST node = pending[idx];
+    if (!node)
+      continue;
+    if (isSmall(node) || tasks.size() + pending.size() - idx >= maxTasks) {
+      tasks.push_back(node);
+      continue;
+    }
+    for (AST child : node.children())
+      if (child && seen.insert(child.getImpl()).second)
+        pending.push_back(child);
+  }
+
+  numTasks = tasks.size();
+  llvm::SmallVector<llvm::hash_code> hashes(tasks.size());
+  llvm::SmallVector<std::shared_future<void>> futures;
+  futures.reserve(tasks.size());
+  for (std::size_t idx = 0; idx < tasks.size(); ++idx)
+    futures.emplace_back(pool.async(
+        [node = tasks[idx], &hash = hashes[idx]] { hash = node.hash(); }));
+  for (auto &future : futures)
+    future.wait();
+
+  llvm::DenseMap<ASTImpl *, llvm::hash_code> memo;
+  for (auto [node, hash] : llvm::zip(tasks, hashes))
+    memo.try_emplace(node.getImpl(), hash);
+  return detail::hashWithMemo(ast, memo);
+}
+
+} // namespace ast
@@ -0,0 +1,201 @@
+#include "ast/ASTRewrite.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/FormatVariadic.h"
+
+namespace ast {
+
+void RewritePatternSet::print(llvm::raw_ostream &os) const {
+  for (unsigned idx = 0, e = rules.size(); idx != e; ++idx) {
+    const auto &rule = rules[idx];
+    if (rule.name.empty())
+      os << '#' << idx;
+    else
+      os << rule.name;
+    os << llvm::formatv(": matched {0}, applied {1}\n",
+                        rule.statistics.numMatched,
+                        rule.statistics.numApplied);
+  }
+}
+
+AST GreedyRewriteDriver::Rewrite(AST ast) {
+  root = ast;
+  parents.clear();
+  worklist.clear();
+  queued.clear();
+  foreignQueued.clear();
+  converged = true;
+  numVisited = numRewrites = 0;
+  patterns.patterns.Compile();
+
+  addTree(ast);
+  while (!worklist.empty()) {
+    AST node = worklist.pop_back_val();
+    dequeue(node);
+    if (isDetached(node))
+      continue;
+
+    ++numVisited;
+    if (applyRules(node) && maxRewrites && numRewrites >= maxRewrites) {
+      converged = worklist.empty();
+      break;
+    }
+  }
+  return root;
+}
+
+void GreedyRewriteDriver::enqueue(AST ast) {
+  // The queued set is indexed by the node indices of the driver's context,
+  // which say nothing about the nodes of another one.
+  bool inserted = ast.getContext() == context
+                      ? queued.insert(ast)
+                      : foreignQueued.insert(ast.getImpl()).second;
+  if (inserted)
+    worklist.push_back(ast);
+}
+
+void GreedyRewriteDriver::dequeue(AST ast) {
+  if (ast.getContext() == context)
+    queued.erase(ast);
+  else
+    foreignQueued.erase(ast.getImpl());
+}
+
+bool GreedyRewriteDriver::attach(AST ast) {
+  auto [it, inserted] = parents.try_emplace(ast.getImpl());
+  return inserted || (it->second.empty() && ast != root);
+}
+
+void GreedyRewriteDriver::addTree(AST ast) {
+  if (!ast || !attach(ast))
+    return;
+
+  // Nodes are collected parents first, so the LIFO worklist visits children
+  // before their parents. A detached node lost the links to its children, so
+  // it is walked again like a new one.
+  llvm::SmallVector<AST> newNodes;
+  llvm::SmallVector<AST> stack{ast};
+  while (!stack.empty()) {
+    AST node = stack.pop_back_val();
+    newNodes.push_back(node);
+    node.walkChildren([&](AST child) {
+      if (!child)
+        return;
+      bool isNew = attach(child);
+      parents[child.getImpl()].push_back(node.getImpl());
+      if (isNew)
+        stack.push_back(child);
+    });
+  }
+
+  for (AST node : newNodes)
+    enqueue(node);
+}
+
+bool GreedyRewriteDriver::isDetached(AST ast) const {
+  if (ast == root)
+    return false;
+  auto it = parents.find(ast.getImpl());
+  return it == parents.end() || it->second.empty();
+}
+
+bool GreedyRewriteDriver::applyRules(AST ast) {
+  bool applied = false;
+  llvm::SmallVector<AST, 4> children;
+  patterns.patterns.matchAll(ast, [&](unsigned idx) {
+    auto &rule = patterns.rules[idx];
+    ++rule.statistics.numMatched;
+    children.clear();
+    ast.walkChildren([&](AST child) {
+      if (child)
+        children.push_back(child);
+    });
+    AST replacement = rule.rewriteFn(ast, rewriter);
+    if (!replacement)
+      return true;
+
+    ++rule.statistics.numApplied;
+    ++numRewrites;
+    applied = true;
+    if (replacement != ast) {
+      replace(ast, replacement);
+    } else {
+      // Updated in place: the node and its users may match other rules now.
+      updateChildren(ast, children);
+      enqueue(ast);
+      for (ASTImpl *parent : parents.lookup(ast.getImpl()))
+        enqueue(AST(parent));
+    }
+    return false;
+  });
+  return applied;
+}
+
+void GreedyRewriteDriver::replace(AST from, AST to) {
+  auto users = std::move(parents[from.getImpl()]);
+  parents[from.getImpl()].clear();
+  addTree(to);
+
+  llvm::SmallPtrSet<ASTImpl *, 4> updated;
+  for (ASTImpl *user : users) {
+    AST parent(user);
+    if (!updated.insert(user).second || isDetached(parent))
+      continue;
+    parent.remapChildren(
+        [from, to](AST child) { return child == from ? to : child; });
+    parents[to.getImpl()].push_back(user);
+    enqueue(parent);
+  }
+
+  if (from == root)
+    root = to;
+  if (isDetached(from))
+    detach(from);
+}
+
+void GreedyRewriteDriver::updateChildren(AST ast,
+                                         llvm::SmallVectorImpl<AST> &before) {
+  // Parent links are kept per occurrence, so the old and new children are
+  // compared as multisets.
+  llvm::SmallVector<AST, 4> added;
+  ast.walkChildren([&](AST child) {
+    if (!child)
+      return;
+    if (auto it = llvm::find(before, child); it != before.end())
+      before.erase(it);
+    else
+      added.push_back(child);
+  });
+
+  for (AST child : added) {
+    addTree(child);
+    parents[child.getImpl()].push_back(ast.getImpl());
+  }
+  for (AST child : before) {
+    auto &users = parents[child.getImpl()];
+    if (auto it = llvm::find(users, ast.getImpl()); it != users.end())
+      users.erase(it);
+    if (isDetached(child))
+      detach(child);
+  }
+}
+
+void GreedyRewriteDriver::detach(AST ast) {
+  // Unlink the subtree of a dead node, so that nodes only reachable through
+  // it are detached as well.
+  llvm::SmallVector<AST> stack{ast};
+  while (!stack.empty()) {
+    AST node = stack.pop_back_val();
+    node.walkChildren([&](AST child) {
+      if (!child)
+        return;
+      auto it = parents.find(child.getImpl());
+      if (it == parents.end() || it->second.empty())
+        return;
+      llvm::erase_value(it->second, node.getImpl());
+      if (it->second.empty() && child != root)
+        stack.push_back(child);
+    });
+  }
+}
+
+} // namespace ast
@@ -1,54 +1,167 @@
 #include "ast/ASTWalker.h"
 #include "ast/AST.h"
+#include "ast/ASTContext.h"
+#include <algorithm>
 
 namespace ast {
 
 WalkResult ASTWalker::Walk(AST ast) {
-  if (auto iter = visited.find(ast.getImplAsVoidPointer());
-      iter != visited.end()) {
-    return iter->second;
-  }
+  if (auto result = lookupVisited(ast))
+    return *result;
 
   if (order == WalkOrder::PostOrder) {
     auto childrenResult = walkChildren(ast);
-    if (childrenResult.isInterrupt()) {
-      visited.try_emplace(ast.getImplAsVoidPointer(), WalkResult::interrupt());
-      return WalkResult::interrupt();
-    }
+    if (childrenResult.isInterrupt())
+      return setVisited(ast, WalkResult::interrupt());
   }
 
   for (const auto &fn : functions) {
     auto result = fn(ast);
-    if (result.isInterrupt()) {
-      visited.try_emplace(ast.getImplAsVoidPointer(), WalkResult::interrupt());
-      return WalkResult::interrupt();
-    }
-    if (result.isSkip()) {
-      visited.try_emplace(ast.getImplAsVoidPointer(), WalkResult::skip());
-      return WalkResult::skip();
-    }
+    if (result.isInterrupt())
+      return setVisited(ast, WalkResult::interrupt());
+    if (result.isSkip())
+      return setVisited(ast, WalkResult::skip());
   }
 
   if (order == WalkOrder::PreOrder) {
     auto childrenResult = walkChildren(ast);
-    if (childrenResult.isInterrupt()) {
-      visited.try_emplace(ast.getImplAsVoidPointer(), WalkResult::interrupt());
-      return WalkResult::interrupt();
-    }
+    if (childrenResult.isInterrupt())
+      return setVisited(ast, WalkResult::interrupt());
   }
 
-  visited.try_emplace(ast.getImplAsVoidPointer(), WalkResult::success());
-  return WalkResult::success();
+  return setVisited(ast, WalkResult::success());
 }
 
 WalkResult ASTWalker::walkChildren(AST ast) {
   WalkResult result;
+  if (!kindFilter.empty() && !mayContainFilteredKind(ast))
+    return result;
   ast.walkChildren([&result, this](AST child) {
-    if (!result.isSuccess())
+    if (result.isInterrupt())
       return;
-    result = Walk(child);
+    // A skipped child only skips its own subtree, not its siblings.
+    if (Walk(child).isInterrupt())
+      result = WalkResult::interrupt();
   });
   return result;
 }
 
+std::optional<WalkResult> ASTWalker::lookupVisited(AST ast) const {
+  if (ast && ast.getContext() == visitedContext &&
+      ast.getIndex() < visitedByIndex.size())
+    if (auto result = visitedByIndex[ast.getIndex()])
+      return result;
+  if (auto iter = visited.find(ast.getImplAsVoidPointer());
+      iter != visited.end())
+    return iter->second;
+  return std::nullopt;
+}
+
+WalkResult ASTWalker::setVisited(AST ast, WalkResult result) {
+  // Small walks stay in the map, so that they do not pay for the node
+  // indices of the whole context.
+  constexpr std::size_t minIndexedWalk = 64;
+  if (ast && !visitedContext)
+    visitedContext = ast.getContext();
+  if (ast && ast.getContext() == visitedContext &&
+      visited.size() >= minIndexedWalk) {
+    auto idx = ast.getIndex();
+    if (idx >= visitedByIndex.size())
+      visitedByIndex.resize(
+          std::max<std::size_t>(idx + 1, 2 * visitedByIndex.size()));
+    visitedByIndex[idx] = result;
+  } else {
+    visited.try_emplace(ast.getImplAsVoidPointer(), result);
+  }
+  return result;
+}
+
+bool ASTWalker::mayContainFilteredKind(AST ast) {
+  ASTContext *context = ast.getContext();
+  if (context != filterMaskContext) {
+    filterMaskContext = context;
+    filterMask = 0;
+    for (ID kind : kindFilter) {
+      auto *kindProperty = context->GetASTKindProperty(kind);
+      // A kind without a bit here may still occur in children of other
+      // contexts.
+      if (!kindProperty) {
+        filterMask = ~std::uint64_t(0);
+        break;
+      }
+      filterMask |= kindProperty->getKindMask();
+    }
+  }
+
+  if (!(ast.getASTKindProperty().getMayContainMask() & filterMask))
+    return false;
+  return !ast.hasSummary() || (ast.getDescendantKindMask() & filterMask);
+}
+
+void ASTFusedWalker::Walk(AST ast) {
+  interrupted.assign(passes.size(), false);
+  context = ast ? ast.getContext() : nullptr;
+  visited.assign(passes.size(),
+                 llvm::BitVector(context ? context->getNumNodeIndices() : 0));
+  foreignVisited.clear();
+  foreignVisited.resize(passes.size());
+  llvm::SmallVector<unsigned, 8> active;
+  for (unsigned pass = 0, e = passes.size(); pass != e; ++pass)
+    active.push_back(pass);
+  if (ast)
+    walkNode(ast, active);
+}
+
+bool ASTFusedWalker::markVisited(unsigned pass, AST ast) {
+  // Node indices are only dense within the context of the root.
+  if (ast.getContext() != context)
+    return foreignVisited[pass].insert(ast.getImplAsVoidPointer()).second;
+  auto &bits = visited[pass];
+  auto idx = ast.getIndex();
+  if (idx >= bits.size())
+    bits.resize(std::max<std::size_t>(idx + 1, context->getNumNodeIndices()));
+  if (bits.test(idx))
+    return false;
+  bits.set(idx);
+  return true;
+}
+
+void ASTFusedWalker::walkNode(AST ast, llvm::ArrayRef<unsigned> active) {
+  // passes seeing `ast` for the first time
+  llvm::SmallVector<unsigned, 8> visiting;
+  for (unsigned pass : active)
+    if (markVisited(pass, ast))
+      visiting.push_back(pass);
+  if (visiting.empty())
+    return;
+
+  // passes entering the children of `ast`
+  llvm::SmallVector<unsigned, 8> entering;
+  for (unsigned pass : visiting) {
+    const auto &preVisit = passes[pass].preVisit;
+    auto result = preVisit ? preVisit(ast) : WalkResult::success();
+    if (result.isInterrupt())
+      interrupted[pass] = true;
+    else if (!result.isSkip())
+      entering.push_back(pass);
+  }
+
+  if (!entering.empty())
+    ast.walkChildren([&](AST child) {
+      if (!child)
+        return;
+      // passes interrupted in an earlier sibling
+      llvm::erase_if(entering,
+                     [&](unsigned pass) { return interrupted[pass]; });
+      if (!entering.empty())
+        walkNode(child, entering);
+    });
+
+  for (unsigned pass : visiting) {
+    const auto &postVisit = passes[pass].postVisit;
+    if (!interrupted[pass] && postVisit && postVisit(ast).isInterrupt())
+      interrupted[pass] = true;
+  }
+}
+
 } // namespace ast
@@ -1,7 +1,16 @@
 #include "TestAST.h"
 #include "TestAST2.h"
 #include "TestASTVisitor.h"
+#include "ast/ASTBulkBuilder.h"
+#include "ast/ASTCloner.h"
 #include "ast/ASTContext.h"
+#include "ast/ASTDiff.h"
+#include "ast/ASTGenerator.h"
+#include "ast/ASTList.h"
+#include "ast/ASTNodeSet.h"
+#include "ast/ASTParallel.h"
+#include "ast/ASTRewrite.h"
+#include "ast/ASTSetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
@@ -130,4 +139,1361 @@ visit Integer : 4
   }
 }
 
+TEST_CASE("AST Set Registry Test" * doctest::test_suite("ast test suite")) {
+  ASTSetRegistry registry;
+  registry.RegisterASTSet<TestASTSet>();
+  CHECK_FALSE(registry.isFrozen());
+  registry.Freeze();
+
+  SUBCASE("Shared kind table") {
+    ASTContext ctx1(registry);
+    ASTContext ctx2(registry);
+    CHECK(registry.isFrozen());
+    CHECK(ctx1.isSharingKinds());
+    CHECK_EQ(ctx1.GetASTKindProperty(ID::get<TestFor>()),
+             ctx2.GetASTKindProperty(ID::get<TestFor>()));
+    // each context gets a set of its own
+    CHECK_NE(ctx1.GetOrRegisterASTSet<TestASTSet>(),
+             ctx2.GetOrRegisterASTSet<TestASTSet>());
+    CHECK_EQ(ctx1.GetOrRegisterASTSet<TestASTSet>()->getContext(), &ctx1);
+    CHECK_EQ(ctx1.GetOrRegisterASTSet<TestASTSet>(),
+             ctx1.GetOrRegisterASTSet<TestASTSet>());
+
+    auto one = Integer::create({}, &ctx1, 1);
+    auto other = Integer::create({}, &ctx2, 1);
+    CHECK(one.isEqual(other));
+    CHECK_EQ(&one.getASTKindProperty(), &other.getASTKindProperty());
+  }
+
+  SUBCASE("Process-wide registry") {
+    auto &global = ASTSetRegistry::get<TestASTSet>();
+    CHECK(global.isFrozen());
+    CHECK_EQ(&global, &ASTSetRegistry::get<TestASTSet>());
+
+    ASTContext ctx(global);
+    auto testAST1 = TestAST1::create({}, &ctx, 1, 2);
+    CHECK_EQ(testAST1.toString(), "TestAST1(1, 2)");
+  }
+}
+
+TEST_CASE("AST Clone Test" * doctest::test_suite("ast test suite")) {
+  ASTContext src;
+  src.GetOrRegisterASTSet<TestASTSet>();
+  ASTContext dst;
+  dst.GetOrRegisterASTSet<TestASTSet>();
+
+  SUBCASE("Clone TableGen AST") {
+    auto one = Integer::create({}, &src, 1);
+    auto two = Integer::create({}, &src, 2);
+    auto testFor = TestFor::create({}, &src, "iter", one, two, one, two);
+    testFor.setHasBraceTag(true);
+
+    auto cloned = testFor.clone(&dst);
+    CHECK(cloned.isEqual(testFor));
+    CHECK_NE(cloned, testFor);
+    CHECK_EQ(cloned.getIterName(), "iter");
+    CHECK(cloned.getHasBraceTag());
+    CHECK_EQ(&cloned.getASTKindProperty(),
+             dst.GetASTKindProperty(ID::get<TestFor>()));
+
+    CHECK_NE(cloned.getFromE(), one);
+    CHECK_EQ(cloned.getFromE(), cloned.getStepE());
+    CHECK_EQ(cloned.getToE(), cloned.getBodyE());
+  }
+
+  SUBCASE("Clone hand-written AST") {
+    auto testAST1 = TestAST1::create({}, &src, 1, 2);
+    auto testAST2 = TestAST1::create({}, &src, 3, 4);
+    auto testIf = TestIf::create({}, &src, testAST1, testAST2, testAST1);
+
+    auto cloned = testIf.clone(&dst);
+    CHECK(cloned.isEqual(testIf));
+    CHECK_EQ(cloned.toString(), testIf.toString());
+    CHECK_NE(cloned.getCondition(), testAST1);
+    CHECK_EQ(cloned.getCondition(), cloned.getElseBranch());
+  }
+}
+
+TEST_CASE("AST Side Table Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto testFor = TestFor::create({}, &ctx, "iter", one, two, one, two);
+
+  auto &table = ctx.GetOrCreateSideTable<SubtreeSizeTable>();
+  CHECK_EQ(&table, &ctx.GetOrCreateSideTable<SubtreeSizeTable>());
+
+  SUBCASE("Lazy computation") {
+    CHECK_EQ(table.lookup(testFor), nullptr);
+    CHECK_EQ(table.get(testFor), 5);
+    CHECK_EQ(table.numComputed, 3);
+    CHECK_EQ(table.get(testFor), 5);
+    CHECK_EQ(table.numComputed, 3);
+    CHECK_EQ(*table.lookup(one), 1);
+  }
+
+  SUBCASE("Invalidation") {
+    table.get(testFor);
+    testFor.setHasBraceTag(true);
+    CHECK_EQ(table.lookup(testFor), nullptr);
+    CHECK_EQ(table.get(testFor), 5);
+    CHECK_EQ(table.numComputed, 4);
+
+    table.invalidate(one);
+    CHECK_EQ(table.get(one), 1);
+    CHECK_EQ(table.numComputed, 5);
+
+    table.clear();
+    CHECK_EQ(table.lookup(testFor), nullptr);
+  }
+
+  SUBCASE("Mutated descendants") {
+    ctx.EnableChangeTracking();
+    auto block = TestBlock::create({}, &ctx, std::vector<AST>{one});
+    auto outer = TestBlock::create({}, &ctx, std::vector<AST>{block});
+    CHECK_EQ(table.get(outer), 3);
+    block.setChild(0, testFor);
+    CHECK_EQ(table.lookup(outer), nullptr);
+    CHECK_EQ(table.get(outer), 7);
+  }
+}
+
+TEST_CASE("AST Change Tracking Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ctx.EnableChangeTracking();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto inner = TestFor::create({}, &ctx, "i", one, two, one, two);
+  auto outer = TestFor::create({}, &ctx, "j", one, two, one, inner);
+  auto sibling = TestFor::create({}, &ctx, "k", one, two, one, two);
+  auto root = TestIf::create({}, &ctx, one, outer, sibling);
+
+  CHECK_EQ(root.getContext(), &ctx);
+  CHECK_FALSE(root.isSubtreeDirty());
+
+  inner.setHasBraceTag(true);
+  CHECK(inner.isDirty());
+  CHECK(inner.isSubtreeDirty());
+  CHECK_FALSE(outer.isDirty());
+  CHECK(outer.isSubtreeDirty());
+  CHECK(root.isSubtreeDirty());
+  CHECK_FALSE(sibling.isSubtreeDirty());
+
+  llvm::SmallVector<AST> visited;
+  root.walk<WalkOrder::PreOrder>([&](AST ast) {
+    if (!ast.isSubtreeDirty())
+      return WalkResult::skip();
+    visited.push_back(ast);
+    return WalkResult::success();
+  });
+  CHECK_EQ(visited.size(), 3);
+  CHECK_EQ(visited[0], root);
+  CHECK_EQ(visited[1], outer);
+  CHECK_EQ(visited[2], inner);
+
+  ctx.ClearChanges();
+  CHECK_FALSE(inner.isDirty());
+  CHECK_FALSE(root.isSubtreeDirty());
+
+  // replaced children no longer reach their old parents
+  outer.setChild(3, two);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{sibling, sibling});
+  block.remapChildren([&](AST) -> AST { return one; });
+  ctx.ClearChanges();
+  inner.setHasBraceTag(false);
+  sibling.setHasBraceTag(true);
+  CHECK(inner.isSubtreeDirty());
+  CHECK_FALSE(outer.isSubtreeDirty());
+  CHECK(root.isSubtreeDirty());
+  CHECK_FALSE(block.isSubtreeDirty());
+}
+
+TEST_CASE("AST Diff Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ASTContext other;
+  other.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto three = Integer::create({}, &ctx, 3);
+
+  SUBCASE("Structural hash") {
+    auto testFor = TestFor::create({}, &ctx, "i", one, two, one, two);
+    auto cloned = testFor.clone(&other);
+    CHECK_EQ(testFor.hash(), cloned.hash());
+    cloned.setHasBraceTag(true);
+    CHECK_EQ(testFor.hash(), cloned.hash());
+    CHECK_NE(testFor.hash(),
+             TestFor::create({}, &ctx, "j", one, two, one, two).hash());
+    CHECK_NE(one.hash(), two.hash());
+  }
+
+  SUBCASE("Identical trees") {
+    auto testFor = TestFor::create({}, &ctx, "i", one, two, one, two);
+    CHECK(ASTDiff().Diff(testFor, testFor.clone(&other)).empty());
+    // trusting the hashes alone
+    CHECK(ASTDiff(false).Diff(testFor, testFor.clone(&other)).empty());
+  }
+
+  SUBCASE("Update and replace") {
+    auto from = TestFor::create({}, &ctx, "i", one, two, one, two);
+    auto to = TestFor::create({}, &ctx, "j", one, three, one,
+                              TestAST1::create({}, &ctx, 1, 2));
+    auto edits = ASTDiff().Diff(from, to);
+    REQUIRE_EQ(edits.size(), 3);
+    CHECK_EQ(edits[0].kind, ASTEdit::Kind::Update);
+    CHECK_EQ(edits[0].from, from);
+    CHECK_EQ(edits[1].kind, ASTEdit::Kind::Update);
+    CHECK_EQ(edits[1].from, two);
+    CHECK_EQ(edits[1].to, three);
+    CHECK_EQ(edits[1].parent, from);
+    CHECK_EQ(edits[1].index, 1);
+    CHECK_EQ(edits[2].kind, ASTEdit::Kind::Replace);
+    CHECK_EQ(edits[2].from, two);
+    CHECK_EQ(edits[2].index, 3);
+  }
+
+  SUBCASE("Insert and delete") {
+    auto from = TestBlock::create({}, &ctx, std::vector<AST>{one, two, three});
+    auto inserted =
+        TestBlock::create({}, &ctx, std::vector<AST>{one, two, two, three});
+    auto edits = ASTDiff().Diff(from, inserted);
+    REQUIRE_EQ(edits.size(), 2);
+    CHECK_EQ(edits[0].kind, ASTEdit::Kind::Update);
+    CHECK_EQ(edits[1].kind, ASTEdit::Kind::Insert);
+    CHECK_EQ(edits[1].to, two);
+    CHECK_EQ(edits[1].index, 2);
+
+    edits = ASTDiff().Diff(inserted, from);
+    REQUIRE_EQ(edits.size(), 2);
+    CHECK_EQ(edits[1].kind, ASTEdit::Kind::Delete);
+    CHECK_EQ(edits[1].from, two);
+    CHECK_EQ(edits[1].index, 2);
+  }
+}
+
+TEST_CASE("AST Matcher Test" * doctest::test_suite("ast test suite")) {
+  using namespace match;
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto zero = Integer::create({}, &ctx, 0);
+  auto one = Integer::create({}, &ctx, 1);
+  auto ten = Integer::create({}, &ctx, 10);
+  auto body = TestAST1::create({}, &ctx, 1, 2);
+  auto testFor = TestFor::create({}, &ctx, "i", zero, ten, one, body);
+
+  SUBCASE("Combinators") {
+    CHECK(m<TestFor>().match(testFor));
+    CHECK_FALSE(m<Integer>().match(testFor));
+    CHECK(m<TestFor>(eq("i"), m<Integer>(eq(0)), any, m<Integer>(eq(1)), any)
+              .match(testFor));
+    CHECK_FALSE(m<TestFor>(eq("j"), any, any, any, any).match(testFor));
+    CHECK_FALSE(
+        m<TestFor>(any, m<Integer>(eq(1)), any, any, any).match(testFor));
+
+    Integer to;
+    AST bodyE;
+    CHECK(m<TestFor>(any, any, bind(to, m<Integer>()), any, bind(bodyE))
+              .match(testFor));
+    CHECK_EQ(to, ten);
+    CHECK_EQ(bodyE, body);
+  }
+
+  SUBCASE("Generated patterns") {
+    AST toE;
+    CHECK(ZeroStartFor(toE).match(testFor));
+    CHECK_EQ(toE, ten);
+
+    std::string iterName;
+    Integer step;
+    CHECK(UnitStepFor(iterName, step).match(testFor));
+    CHECK_EQ(iterName, "i");
+    CHECK_EQ(step, one);
+    CHECK_FALSE(UnitStepFor(iterName, step)
+                    .match(TestFor::create({}, &ctx, "j", zero, ten, ten,
+                                           body)));
+  }
+
+  SUBCASE("Pattern set") {
+    PatternSet patterns;
+    auto anyFor = patterns.add(m<TestFor>());
+    AST toE;
+    auto zeroStart = patterns.add(ZeroStartFor(toE), 2);
+    auto anyNode = patterns.add(any);
+    auto integer = patterns.add(m<Integer>(eq(0)), 3);
+    patterns.Compile();
+
+    CHECK_EQ(patterns.getCandidates(ID::get<TestFor>()).size(), 3);
+    CHECK_EQ(patterns.match(testFor), zeroStart);
+    CHECK_EQ(patterns.match(zero), integer);
+    CHECK_EQ(patterns.match(one), anyNode);
+    CHECK_EQ(patterns.match(body), anyNode);
+
+    llvm::SmallVector<unsigned> matched;
+    patterns.matchAll(testFor, [&](unsigned pattern) {
+      matched.push_back(pattern);
+      return true;
+    });
+    REQUIRE_EQ(matched.size(), 3);
+    CHECK_EQ(matched[0], zeroStart);
+    CHECK_EQ(matched[1], anyFor);
+    CHECK_EQ(matched[2], anyNode);
+  }
+
+  SUBCASE("Pattern set member kinds") {
+    PatternSet patterns;
+    auto blockStart =
+        patterns.add(m<TestFor>(any, m<TestBlock>(), any, any, any), 2);
+    Integer from;
+    auto integerStart =
+        patterns.add(m<TestFor>(any, bind(from, m<Integer>()), any, any, any));
+    patterns.Compile();
+
+    CHECK_EQ(patterns.match(testFor), integerStart);
+    CHECK_EQ(from, zero);
+
+    using AnyFor = decltype(m<TestFor>(any, any, any, any, any));
+    CHECK_EQ(AnyFor::getMemberKind(testFor, 4), ID::get<TestAST1>());
+    // the string member has no kind
+    CHECK_FALSE(AnyFor::getMemberKind(testFor, 0));
+
+    auto block = TestBlock::create({}, &ctx, std::vector<AST>{});
+    auto blockFor = TestFor::create({}, &ctx, "i", block, ten, one, body);
+    CHECK_EQ(patterns.match(blockFor), blockStart);
+  }
+}
+
+TEST_CASE("AST Rewrite Test" * doctest::test_suite("ast test suite")) {
+  using namespace match;
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  RewritePatternSet patterns;
+  auto unwrap = patterns.add(
+      m<TestBlock>(any),
+      [](AST ast, ASTRewriter &) -> AST {
+        auto stmts = ast.cast<TestBlock>().getStmts();
+        return stmts.size() == 1 ? stmts[0] : AST();
+      },
+      1, "unwrap-block");
+  auto countDown = patterns.add(
+      m<Integer>(),
+      [](AST ast, ASTRewriter &rewriter) -> AST {
+        auto value = ast.cast<Integer>().getValue();
+        if (value < 2)
+          return AST();
+        return rewriter.create<Integer>({}, value - 1);
+      },
+      1, "count-down");
+
+  auto three = Integer::create({}, &ctx, 3);
+  auto two = Integer::create({}, &ctx, 2);
+  auto one = Integer::create({}, &ctx, 1);
+  auto body = TestAST1::create({}, &ctx, 1, 2);
+
+  SUBCASE("Fixpoint") {
+    auto testFor = TestFor::create(
+        {}, &ctx, "i", TestBlock::create({}, &ctx, std::vector<AST>{three}),
+        two, one, body);
+    auto root = TestBlock::create({}, &ctx, std::vector<AST>{testFor});
+
+    GreedyRewriteDriver driver(&ctx, patterns);
+    AST result = driver.Rewrite(root);
+    CHECK(driver.isConverged());
+    CHECK_EQ(result, testFor);
+    CHECK(result.isEqual(
+        TestFor::create({}, &ctx, "i", one, one, one, body)));
+
+    CHECK_EQ(patterns.getStatistics(unwrap).numApplied, 2);
+    CHECK_EQ(patterns.getStatistics(countDown).numApplied, 3);
+    CHECK_EQ(driver.getNumRewrites(), 5);
+
+    std::string stats;
+    llvm::raw_string_ostream os(stats);
+    patterns.print(os);
+    CHECK_EQ(os.str(), "unwrap-block: matched 2, applied 2\n"
+                       "count-down: matched 6, applied 3\n");
+
+    // counters are per Rewrite
+    CHECK_EQ(driver.Rewrite(result), result);
+    CHECK(driver.isConverged());
+    CHECK_EQ(driver.getNumRewrites(), 0);
+    unsigned numNodes = 0;
+    result.walk([&](AST) {
+      ++numNodes;
+      return WalkResult::success();
+    });
+    CHECK_EQ(driver.getNumVisited(), numNodes);
+  }
+
+  SUBCASE("Rewrite limit") {
+    auto testFor = TestFor::create({}, &ctx, "i", three, two, one, body);
+    GreedyRewriteDriver driver(&ctx, patterns);
+    driver.setMaxRewrites(1);
+    driver.Rewrite(testFor);
+    CHECK_FALSE(driver.isConverged());
+    CHECK_EQ(driver.getNumRewrites(), 1);
+  }
+
+  SUBCASE("In-place update") {
+    patterns.add(m<TestFor>(any, any, any, m<TestBlock>(), any),
+                 [](AST ast, ASTRewriter &rewriter) -> AST {
+                   ast.setChild(2, rewriter.create<Integer>({}, 3));
+                   return ast;
+                 });
+    auto step = TestBlock::create({}, &ctx, std::vector<AST>{});
+    auto testFor = TestFor::create({}, &ctx, "i", one, one, step, body);
+
+    GreedyRewriteDriver driver(&ctx, patterns);
+    CHECK_EQ(driver.Rewrite(testFor), testFor);
+    CHECK(driver.isConverged());
+    // the installed step is rewritten like any other node
+    CHECK(testFor.isEqual(
+        TestFor::create({}, &ctx, "i", one, one, one, body)));
+    CHECK_EQ(patterns.getStatistics(countDown).numApplied, 2);
+  }
+
+  SUBCASE("Foreign replacement") {
+    ASTContext other;
+    other.GetOrRegisterASTSet<TestASTSet>();
+    auto foreign = Integer::create({}, &other, 3);
+    auto root = TestBlock::create({}, &ctx, std::vector<AST>{foreign});
+
+    GreedyRewriteDriver driver(&ctx, patterns);
+    AST result = driver.Rewrite(root);
+    CHECK(driver.isConverged());
+    CHECK(result.isEqual(one));
+    CHECK_EQ(result.getContext(), &ctx);
+  }
+}
+
+TEST_CASE("AST Map And Variant Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ASTContext other;
+  other.GetOrRegisterASTSet<TestASTSet>();
+
+  using Symbols = ASTMap<std::string, AST>;
+  using Result = std::variant<std::string, AST>;
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+
+  SUBCASE("Sorted map") {
+    Symbols symbols{{"b", two}, {"a", one}, {"b", one}};
+    REQUIRE_EQ(symbols.size(), 2);
+    CHECK_EQ(symbols.begin()->first, "a");
+    CHECK_EQ(symbols.lookup("b"), two);
+    CHECK_FALSE(symbols.lookup("c"));
+
+    CHECK(symbols.try_emplace("c", one).second);
+    CHECK_FALSE(symbols.try_emplace("c", two).second);
+    CHECK_EQ(symbols.lookup("c"), one);
+    CHECK(symbols.erase("a"));
+    CHECK_FALSE(symbols.contains("a"));
+    symbols["a"] = two;
+    CHECK_EQ(symbols.begin()->second, two);
+  }
+
+  SUBCASE("Tree members") {
+    auto scope = TestScope::create({}, &ctx, Symbols{{"b", two}, {"a", one}},
+                                   Result(AST(one)));
+    auto reordered = TestScope::create(
+        {}, &ctx, Symbols{{"a", one}, {"b", two}}, Result(AST(one)));
+    CHECK(scope.isEqual(reordered));
+    CHECK_EQ(scope.hash(), reordered.hash());
+
+    llvm::SmallVector<AST> children;
+    scope.walkChildren([&](AST child) { children.push_back(child); });
+    REQUIRE_EQ(children.size(), 3);
+    CHECK_EQ(children[0], one);
+    CHECK_EQ(children[1], two);
+    CHECK_EQ(children[2], one);
+
+    auto named = TestScope::create({}, &ctx, Symbols{{"a", one}, {"b", two}},
+                                   Result("a"));
+    CHECK_FALSE(scope.isEqual(named));
+    CHECK_NE(scope.hash(), named.hash());
+    CHECK_EQ(named.toString(), "scope {\n  a = 1\n  b = 2\n} -> a");
+
+    auto cloned = scope.clone(&other);
+    CHECK(cloned.isEqual(scope));
+    CHECK_EQ(cloned.getSymbols().lookup("a"),
+             std::get<AST>(cloned.getResult()));
+    CHECK_NE(cloned.getSymbols().lookup("a"), one);
+  }
+}
+
+TEST_CASE("Generated Member Walk Test" * doctest::test_suite("ast test suite")) {
+  static_assert(HasGeneratedWalk<TestFor> && HasGeneratedEqual<TestFor>);
+  static_assert(!HasGeneratedWalk<TestIf> && !HasGeneratedEqual<TestIf>);
+
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{one, two, one});
+  auto scope = TestScope::create({}, &ctx,
+                                 ASTMap<std::string, AST>{{"a", one}},
+                                 std::variant<std::string, AST>(AST(two)));
+  auto testFor = TestFor::create({}, &ctx, "i", one, block, two, scope);
+
+  auto checkWalk = [](auto node) {
+    llvm::SmallVector<AST> generated;
+    node.walkChildren([&](AST child) { generated.push_back(child); });
+
+    llvm::SmallVector<AST> generic;
+    const auto &members = node.traversalOrder();
+    detail::ASTDataHandler<std::remove_cvref_t<decltype(members)>>::walk(
+        members, [&](AST child) { generic.push_back(child); });
+    CHECK_EQ(generated, generic);
+    for (std::size_t idx = 0; idx < generic.size(); ++idx)
+      CHECK_EQ(node.getChild(idx), generic[idx]);
+    CHECK_EQ(llvm::SmallVector<AST>(node.children()), generic);
+  };
+  checkWalk(one);
+  checkWalk(block);
+  checkWalk(scope);
+  checkWalk(testFor);
+
+  // nested lookup stops at the requested child
+  using Nested = std::vector<std::optional<AST>>;
+  Nested nested{std::nullopt, AST(one), AST(two)};
+  std::size_t idx = 1;
+  AST found;
+  CHECK(detail::ASTDataHandler<Nested>::findChild(nested, idx, found));
+  CHECK_EQ(found, AST(two));
+  idx = 3;
+  CHECK_FALSE(detail::ASTDataHandler<Nested>::findChild(nested, idx, found));
+  CHECK_EQ(idx, 1);
+
+  // the cursor resumes at the element it stopped in
+  detail::ChildCursor cursor;
+  CHECK(detail::nextMemberChild(nested, cursor, found));
+  CHECK_EQ(found, AST(one));
+  CHECK_EQ(cursor.element, 1);
+  CHECK(detail::nextMemberChild(nested, cursor, found));
+  CHECK_EQ(found, AST(two));
+  CHECK_EQ(cursor.element, 2);
+  CHECK_FALSE(detail::nextMemberChild(nested, cursor, found));
+
+  // hand-written kinds step through their traversal order as well
+  auto testIf = TestIf::create({}, &ctx, one, AST(), two);
+  llvm::SmallVector<AST> ifChildren(testIf.children());
+  CHECK_EQ(ifChildren, (llvm::SmallVector<AST>{one, AST(), two}));
+  CHECK_EQ(testIf.getChild(2), AST(two));
+
+  auto other = TestFor::create({}, &ctx, "i", one, block, one, scope);
+  CHECK_FALSE(testFor.isEqual(other));
+  CHECK(testFor.isEqual(
+      TestFor::create({}, &ctx, "i", one, block.clone(&ctx), two, scope)));
+  CHECK_FALSE(testFor.isEqual(
+      TestFor::create({}, &ctx, "j", one, block, two, scope)));
+}
+
+TEST_CASE("AST Child Slot Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto zero = Integer::create({}, &ctx, 0);
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{one, two});
+  auto testFor = TestFor::create({}, &ctx, "i", zero, one, two, block);
+
+  CHECK(testFor.getASTKindProperty().hasFixedChildren());
+  CHECK(zero.getASTKindProperty().hasFixedChildren());
+  CHECK_FALSE(block.getASTKindProperty().hasFixedChildren());
+
+  CHECK_EQ(zero.getNumChildren(), 0);
+  CHECK_EQ(testFor.getNumChildren(), 4);
+  CHECK_EQ(testFor.getChild(0), AST(zero));
+  CHECK_EQ(testFor.getChild(1), AST(one));
+  CHECK_EQ(testFor.getChild(2), AST(two));
+  CHECK_EQ(testFor.getChild(3), AST(block));
+
+  auto &table = ctx.GetOrCreateSideTable<SubtreeSizeTable>();
+  table.get(testFor);
+  testFor.setChild(2, one);
+  CHECK_EQ(testFor.getStepE(), AST(one));
+  CHECK_EQ(table.lookup(testFor), nullptr);
+
+  CHECK_EQ(block.getNumChildren(), 2);
+  CHECK_EQ(block.getChild(1), AST(two));
+  block.setChild(1, zero);
+  CHECK_EQ(block.getStmts()[1], AST(zero));
+  CHECK_EQ(block.getChild(0), AST(one));
+}
+
+TEST_CASE("AST Children Range Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto zero = Integer::create({}, &ctx, 0);
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{one, two});
+  auto scope = TestScope::create({}, &ctx,
+                                 ASTMap<std::string, AST>{{"a", zero}},
+                                 std::variant<std::string, AST>(AST(block)));
+  auto testFor = TestFor::create(
+      {}, &ctx, "i", Integer::create({}, &ctx, 10),
+      Integer::create({}, &ctx, 11), Integer::create({}, &ctx, 12), scope);
+
+  llvm::SmallVector<AST> children(testFor.children());
+  CHECK_EQ(children.size(), 4);
+  CHECK_EQ(children[3], AST(scope));
+
+  llvm::SmallVector<AST> scopeChildren(scope.children());
+  CHECK_EQ(scopeChildren.size(), 2);
+  CHECK_EQ(scopeChildren[0], AST(zero));
+  CHECK_EQ(scopeChildren[1], AST(block));
+  CHECK_EQ(scope.getChild(1), AST(block));
+
+  CHECK(llvm::any_of(block.children(), [&](AST ast) { return ast == two; }));
+  CHECK_FALSE(
+      llvm::any_of(block.children(), [&](AST ast) { return ast == zero; }));
+
+  auto checkOrder = [&](auto range, WalkOrder order) {
+    llvm::SmallVector<AST> walked;
+    ASTWalker walker(order);
+    walker.addFn([&](AST ast) {
+      walked.push_back(ast);
+      return WalkResult::success();
+    });
+    walker.Walk(testFor);
+    CHECK_EQ(llvm::SmallVector<AST>(range), walked);
+  };
+  checkOrder(testFor.preOrder(), WalkOrder::PreOrder);
+  checkOrder(testFor.postOrder(), WalkOrder::PostOrder);
+
+  llvm::SmallVector<AST> pruned;
+  auto range = testFor.preOrder();
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    pruned.push_back(*it);
+    if ((*it).isa<TestScope>())
+      it.skipChildren();
+  }
+  CHECK_EQ(pruned.size(), 5);
+  CHECK_EQ(pruned.back(), AST(scope));
+
+  CHECK(AST().preOrder().empty());
+}
+
+TEST_CASE("AST Typed Walk Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto zero = Integer::create({}, &ctx, 0);
+  auto ten = Integer::create({}, &ctx, 10);
+  auto range = TestRange::create({}, &ctx, zero, ten);
+  auto inner = TestFor::create({}, &ctx, "j", zero, ten, ten,
+                               TestBlock::create({}, &ctx, std::vector<AST>{}));
+  auto outer = TestFor::create(
+      {}, &ctx, "i", zero, ten, ten,
+      TestBlock::create({}, &ctx, std::vector<AST>{range, inner}));
+
+  const auto &rangeProperty = range.getASTKindProperty();
+  CHECK(rangeProperty.mayContain(ID::get<Integer>()));
+  CHECK_FALSE(rangeProperty.mayContain(ID::get<TestFor>()));
+  CHECK_FALSE(zero.getASTKindProperty().mayContain(ID::get<Integer>()));
+  CHECK(outer.getASTKindProperty().mayContain(ID::get<TestRange>()));
+
+  llvm::SmallVector<llvm::StringRef> iterNames;
+  outer.walk<TestFor>(
+      [&](TestFor testFor) { iterNames.push_back(testFor.getIterName()); });
+  CHECK_EQ(iterNames.size(), 2);
+  CHECK_EQ(iterNames[0], "j");
+  CHECK_EQ(iterNames[1], "i");
+
+  std::size_t numRanges = 0, numIntegers = 0;
+  outer.walk<TestRange, Integer>(
+      [&](auto ast) {
+        if constexpr (std::is_same_v<decltype(ast), TestRange>)
+          ++numRanges;
+        else
+          ++numIntegers;
+        return WalkResult::success();
+      },
+      WalkOrder::PreOrder);
+  CHECK_EQ(numRanges, 1);
+  CHECK_EQ(numIntegers, 2);
+
+  std::size_t numVisited = 0;
+  auto result = outer.walk<TestFor>([&](TestFor) {
+    ++numVisited;
+    return WalkResult::interrupt();
+  });
+  CHECK(result.isInterrupt());
+  CHECK_EQ(numVisited, 1);
+}
+
+TEST_CASE("AST Summary Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto unsummarized = Integer::create({}, &ctx, 7);
+  CHECK_FALSE(unsummarized.hasSummary());
+
+  ctx.EnableChangeTracking();
+  ctx.EnableSummaries();
+  auto zero = Integer::create({}, &ctx, 0);
+  auto ten = Integer::create({}, &ctx, 10);
+  auto range = TestRange::create({}, &ctx, zero, ten);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{range, zero});
+  auto testFor = TestFor::create({}, &ctx, "i", zero, ten, ten, block);
+
+  CHECK_EQ(zero.getSubtreeSize(), 1);
+  CHECK_EQ(zero.getHeight(), 0);
+  CHECK_EQ(zero.getDescendantKindMask(), 0);
+  CHECK_EQ(range.getSubtreeSize(), 3);
+  CHECK_EQ(block.getSubtreeSize(), 5);
+  CHECK_EQ(block.getHeight(), 2);
+  CHECK_EQ(testFor.getSubtreeSize(), 9);
+  CHECK_EQ(testFor.getHeight(), 3);
+
+  auto rangeMask = range.getASTKindProperty().getKindMask();
+  auto forMask = testFor.getASTKindProperty().getKindMask();
+  CHECK((testFor.getDescendantKindMask() & rangeMask));
+  CHECK_FALSE((testFor.getDescendantKindMask() & forMask));
+
+  // bounded kinds know the masks of the kinds they may contain
+  CHECK_EQ(zero.getASTKindProperty().getMayContainMask(), 0);
+  CHECK_EQ(range.getASTKindProperty().getMayContainMask(),
+           zero.getASTKindProperty().getKindMask());
+
+  std::size_t numRanges = 0;
+  testFor.walk<TestRange>([&](TestRange) { ++numRanges; });
+  CHECK_EQ(numRanges, 1);
+
+  // a child without a summary leaves its parents without one
+  CHECK_FALSE(
+      TestBlock::create({}, &ctx, std::vector<AST>{unsummarized}).hasSummary());
+
+  // mutations refresh the ancestors through the tracked parents
+  block.setChild(0, TestFor::create({}, &ctx, "j", zero, ten, ten, zero));
+  CHECK_EQ(block.getSubtreeSize(), 7);
+  CHECK_EQ(testFor.getSubtreeSize(), 11);
+  CHECK((testFor.getDescendantKindMask() & forMask));
+  CHECK_FALSE((testFor.getDescendantKindMask() & rangeMask));
+
+  numRanges = 0;
+  std::size_t numFors = 0;
+  testFor.walk<TestRange>([&](TestRange) { ++numRanges; });
+  testFor.walk<TestFor>([&](TestFor) { ++numFors; });
+  CHECK_EQ(numRanges, 0);
+  CHECK_EQ(numFors, 2);
+
+  // ancestors are refreshed without change tracking as well
+  ASTContext untracked;
+  untracked.GetOrRegisterASTSet<TestASTSet>();
+  untracked.EnableSummaries();
+  auto one = Integer::create({}, &untracked, 1);
+  auto inner = TestBlock::create({}, &untracked, std::vector<AST>{one});
+  auto outer = TestBlock::create({}, &untracked, std::vector<AST>{inner});
+  inner.setChild(0, TestFor::create({}, &untracked, "k", one, one, one, one));
+  CHECK_FALSE(outer.isSubtreeDirty());
+  CHECK_EQ(outer.getSubtreeSize(), 7);
+  numFors = 0;
+  outer.walk<TestFor>([&](TestFor) { ++numFors; });
+  CHECK_EQ(numFors, 1);
+}
+
+TEST_CASE("AST Bulk Builder Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  constexpr std::size_t numStmts = 16;
+  ASTBulkBuilder builder(&ctx);
+  builder.expect<Integer>(numStmts).expect<TestBlock>().Reserve();
+
+  std::vector<AST> stmts;
+  for (std::size_t idx = 0; idx < numStmts; ++idx)
+    stmts.push_back(builder.create<Integer>({}, idx));
+  auto block = builder.create<TestBlock>({}, stmts);
+  CHECK_EQ(builder.getNumCreated(), builder.getNumExpected());
+
+  // children first, then the parent, back to back
+  llvm::SmallVector<AST> postOrder(block.postOrder());
+  for (std::size_t idx = 1; idx < postOrder.size(); ++idx) {
+    AST prev = postOrder[idx - 1];
+    auto distance = reinterpret_cast<const char *>(postOrder[idx].getImpl()) -
+                    reinterpret_cast<const char *>(prev.getImpl());
+    CHECK_EQ(distance, prev.getASTKindProperty().getImplSize());
+  }
+
+  // past the expected counts, nodes come from the regular arena
+  auto extra = builder.create<Integer>({}, 100);
+  CHECK_EQ(extra.getValue(), 100);
+}
+
+TEST_CASE("AST Compaction Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  // interleave the nodes of two trees with garbage
+  std::vector<AST> lhsStmts, rhsStmts;
+  for (std::uint64_t idx = 0; idx < 8; ++idx) {
+    lhsStmts.push_back(Integer::create({}, &ctx, idx));
+    Integer::create({}, &ctx, 100 + idx);
+    rhsStmts.push_back(Integer::create({}, &ctx, 200 + idx));
+  }
+  auto lhs = TestBlock::create({}, &ctx, lhsStmts);
+  auto rhs = TestFor::create({}, &ctx, "i", lhsStmts[0], rhsStmts[1],
+                             rhsStmts[2], TestBlock::create({}, &ctx, rhsStmts));
+
+  ASTContext compacted;
+  compacted.GetOrRegisterASTSet<TestASTSet>();
+  llvm::SmallVector<AST> roots;
+  ASTCloner(&compacted).clone({lhs, rhs}, roots);
+  REQUIRE_EQ(roots.size(), 2);
+  CHECK(roots[0].isEqual(lhs));
+  CHECK(roots[1].isEqual(rhs));
+  CHECK_EQ(roots[1].getChild(0), roots[0].getChild(0));
+
+  // each node directly follows the previous one in pre-order, and the
+  // second tree follows the first
+  auto checkAdjacent = [](AST prev, AST node) {
+    auto distance = reinterpret_cast<const char *>(node.getImpl()) -
+                    reinterpret_cast<const char *>(prev.getImpl());
+    CHECK_EQ(distance, prev.getASTKindProperty().getImplSize());
+  };
+  AST prev;
+  for (AST node : roots[0].preOrder()) {
+    if (prev)
+      checkAdjacent(prev, node);
+    prev = node;
+  }
+  checkAdjacent(prev, roots[1]);
+}
+
+TEST_CASE("AST Collect Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ctx.EnableChangeTracking();
+
+  auto one = Integer::create({}, &ctx, 1);
+  AST roots[] = {
+      TestBlock::create({}, &ctx, std::vector<AST>{one, one}),
+      TestFor::create({}, &ctx, "i", one, one, one, one),
+  };
+  auto before = roots[0].toString() + roots[1].toString();
+  const AST *stmtsData = roots[0].cast<TestBlock>().getStmts().data();
+
+  // garbage, as left behind by rewrites
+  for (std::uint64_t idx = 0; idx < 4096; ++idx)
+    TestBlock::create({}, &ctx,
+                      std::vector<AST>{Integer::create({}, &ctx, idx)});
+  auto grown = ctx.getAllocatedBytes();
+
+  auto &table = ctx.GetOrCreateSideTable<SubtreeSizeTable>();
+  CHECK_EQ(table.get(roots[0]), 3);
+  roots[1].remapChildren([](AST ast) { return ast; });
+  auto numComputed = table.numComputed;
+
+  ctx.Collect(roots);
+  CHECK_LT(ctx.getAllocatedBytes(), grown);
+  CHECK_EQ(roots[0].toString() + roots[1].toString(), before);
+  CHECK_EQ(roots[0].getChild(0), roots[1].getChild(0));
+  CHECK_EQ(roots[0].getContext(), &ctx);
+  // members are moved, not copied
+  CHECK_EQ(roots[0].cast<TestBlock>().getStmts().data(), stmtsData);
+
+  // node keyed state carries over to the moved nodes
+  CHECK_EQ(table.get(roots[0]), 3);
+  CHECK_EQ(table.numComputed, numComputed);
+  CHECK(roots[1].isDirty());
+  CHECK_FALSE(roots[0].isDirty());
+  CHECK_FALSE(roots[0].getChild(0).isDirty());
+  ctx.ClearChanges();
+
+  // parent links are recorded again for the moved nodes
+  roots[0].getChild(0).remapChildren([](AST ast) { return ast; });
+  CHECK(roots[0].isSubtreeDirty());
+  CHECK(roots[1].isSubtreeDirty());
+}
+
+TEST_CASE("AST Create Move Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+
+  // the buffers of rvalue members end up in the node
+  std::vector<AST> stmts{one, one, one};
+  const AST *stmtsData = stmts.data();
+  auto block = TestBlock::create({}, &ctx, std::move(stmts));
+  CHECK_EQ(block.getStmts().data(), stmtsData);
+  CHECK_EQ(block.getStmts().size(), 3);
+
+  // long enough not to be stored inline
+  std::string iterName(64, 'i');
+  const char *iterNameData = iterName.data();
+  auto testFor =
+      TestFor::create({}, &ctx, std::move(iterName), one, one, one, block);
+  CHECK_EQ(testFor.getIterName().data(), iterNameData);
+  CHECK_EQ(testFor.getIterName(), std::string(64, 'i'));
+
+  // each member is moved or copied on its own
+  ASTMap<std::string, AST> symbols;
+  symbols["a"] = one;
+  std::variant<std::string, AST> result(std::string(64, 'r'));
+  const char *resultData = std::get<std::string>(result).data();
+  auto scope = TestScope::create({}, &ctx, symbols, std::move(result));
+  CHECK_EQ(std::get<std::string>(scope.getResult()).data(), resultData);
+  CHECK_EQ(scope.getSymbols().size(), 1);
+  CHECK_EQ(symbols.size(), 1);
+
+  // views and lvalues are copied once
+  std::vector<AST> kept{one};
+  auto copied = TestBlock::create({}, &ctx, kept);
+  CHECK_NE(copied.getStmts().data(), kept.data());
+  CHECK_EQ(TestFor::create({}, &ctx, "i", one, one, one, one).getIterName(),
+           "i");
+
+  // every hop forwards, so a member is moved or copied exactly once
+  CopyCounter::reset();
+  TestCounted::create({}, &ctx, CopyCounter());
+  CHECK_EQ(CopyCounter::numMoves, 1);
+  CHECK_EQ(CopyCounter::numCopies, 0);
+
+  CopyCounter counter;
+  CopyCounter::reset();
+  TestCounted::create({}, &ctx, counter);
+  CHECK_EQ(CopyCounter::numMoves, 0);
+  CHECK_EQ(CopyCounter::numCopies, 1);
+
+  const CopyCounter &view = counter;
+  CopyCounter::reset();
+  TestCounted::create({}, &ctx, view);
+  CHECK_EQ(CopyCounter::numMoves, 0);
+  CHECK_EQ(CopyCounter::numCopies, 1);
+
+  CopyCounter::reset();
+  TestCounted::create({}, &ctx, std::move(counter));
+  CHECK_EQ(CopyCounter::numMoves, 1);
+  CHECK_EQ(CopyCounter::numCopies, 0);
+}
+
+TEST_CASE("AST Node Collection Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{one, two, one});
+  CHECK_EQ(one.getImpl()->getIndex(), 0);
+  CHECK_EQ(block.getImpl()->getIndex(), 2);
+  CHECK_EQ(ctx.getNumNodeIndices(), 3);
+
+  SUBCASE("Node set") {
+    ASTNodeSet set(&ctx);
+    CHECK(set.insert(one));
+    CHECK_FALSE(set.insert(one));
+    CHECK(set.contains(one));
+    CHECK_FALSE(set.contains(two));
+
+    // nodes created after the set
+    auto three = Integer::create({}, &ctx, 3);
+    CHECK_FALSE(set.contains(three));
+    CHECK(set.insert(three));
+    CHECK_EQ(set.size(), 2);
+
+    CHECK(set.erase(one));
+    CHECK_FALSE(set.erase(one));
+    CHECK_EQ(set.size(), 1);
+    set.clear();
+    CHECK(set.empty());
+    CHECK_FALSE(set.contains(three));
+  }
+
+  SUBCASE("List") {
+    ASTContext::Region region(&ctx);
+    ASTList<2> list(region);
+    list.push_back(block);
+    list.push_back(one);
+    CHECK(list.isSmall());
+    list.push_back(two);
+    CHECK_FALSE(list.isSmall());
+    CHECK_GT(region.getAllocatedBytes(), 0);
+    std::vector<AST> expected{block, one, two};
+    CHECK(llvm::ArrayRef<AST>(list) == llvm::ArrayRef(expected));
+
+    // worklist of a pre-order walk
+    ASTNodeSet visited(&ctx);
+    std::vector<std::int64_t> values;
+    list.clear();
+    list.push_back(block);
+    while (!list.empty()) {
+      AST node = list.pop_back_val();
+      if (!visited.insert(node))
+        continue;
+      if (node.isa<Integer>())
+        values.push_back(node.cast<Integer>().getValue());
+      node.walkChildren([&](AST child) { list.push_back(child); });
+    }
+    CHECK_EQ(values, std::vector<std::int64_t>({1, 2}));
+
+    // outside of a region the elements move to the heap
+    auto allocatedBytes = ctx.getAllocatedBytes();
+    ASTList<1> heapList(&ctx);
+    heapList.push_back(one);
+    heapList.push_back(two);
+    heapList.push_back(block);
+    CHECK_FALSE(heapList.isSmall());
+    CHECK_EQ(ctx.getAllocatedBytes(), allocatedBytes);
+    CHECK_EQ(heapList[2], block);
+  }
+}
+
+TEST_CASE("AST Node Index Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ASTContext other;
+  other.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto inner = TestBlock::create({}, &ctx, std::vector<AST>{one, one});
+  auto foreign = Integer::create({}, &other, 2);
+  CHECK_EQ(foreign.getIndex(), one.getIndex());
+
+  // shared nodes are walked once, whatever their context
+  auto root = TestBlock::create(
+      {}, &other, std::vector<AST>{inner, foreign, inner, foreign});
+  unsigned numVisited = 0;
+  root.walk([&](AST) {
+    ++numVisited;
+    return WalkResult::success();
+  });
+  CHECK_EQ(numVisited, 4);
+
+  // side tables key the nodes of other contexts by address
+  auto &table = ctx.GetOrCreateSideTable<SubtreeSizeTable>();
+  CHECK_EQ(table.get(inner), 3);
+  CHECK_EQ(root.getIndex(), inner.getIndex());
+  CHECK_EQ(table.get(root), 9);
+  CHECK_EQ(table.get(inner), 3);
+  CHECK_EQ(*table.lookup(foreign), 1);
+  table.invalidate(root);
+  CHECK_EQ(table.lookup(root), nullptr);
+  CHECK_NE(table.lookup(inner), nullptr);
+
+  // larger walks switch to the node indices midway
+  std::vector<AST> leaves;
+  for (std::uint64_t value = 0; value < 100; ++value)
+    leaves.push_back(Integer::create({}, &ctx, value));
+  auto wide = TestBlock::create(
+      {}, &ctx,
+      std::vector<AST>{TestBlock::create({}, &ctx, leaves),
+                       TestBlock::create({}, &ctx, leaves), foreign});
+  numVisited = 0;
+  wide.walk([&](AST) {
+    ++numVisited;
+    return WalkResult::success();
+  });
+  CHECK_EQ(numVisited, 104);
+
+  // clones are numbered in pre-order
+  auto cloned = inner.clone(&other);
+  CHECK_EQ(cloned.getIndex(), 2);
+  CHECK_EQ(cloned.getChild(0).getIndex(), 3);
+  CHECK_EQ(other.getNumNodeIndices(), 4);
+}
+
+TEST_CASE("AST Vector Equality Test" * doctest::test_suite("ast test suite")) {
+  auto noChild = [](AST, AST) { return false; };
+
+  SUBCASE("Integers") {
+    using Handler = detail::ASTDataHandler<std::vector<std::int32_t>>;
+    std::vector<std::int32_t> lhs(1 << 20);
+    for (std::size_t idx = 0; idx < lhs.size(); ++idx)
+      lhs[idx] = static_cast<std::int32_t>(idx * 7);
+    auto rhs = lhs;
+    CHECK(Handler::isEqual(lhs, rhs, noChild));
+    rhs.back() += 1;
+    CHECK_FALSE(Handler::isEqual(lhs, rhs, noChild));
+    rhs.pop_back();
+    CHECK_FALSE(Handler::isEqual(lhs, rhs, noChild));
+  }
+
+  SUBCASE("Floating point") {
+    using Handler = detail::ASTDataHandler<std::vector<double>>;
+    std::vector<double> lhs(1 << 20, 0.5);
+    auto rhs = lhs;
+    lhs.front() = 0.0;
+    rhs.front() = -0.0;
+    CHECK(Handler::isEqual(lhs, rhs, noChild));
+    lhs.back() = rhs.back() = std::numeric_limits<double>::quiet_NaN();
+    CHECK_FALSE(Handler::isEqual(lhs, rhs, noChild));
+
+    // past the last full block
+    lhs.back() = rhs.back() = 0.5;
+    lhs.push_back(1.0);
+    rhs.push_back(1.0);
+    CHECK(Handler::isEqual(lhs, rhs, noChild));
+    rhs.back() = 2.0;
+    CHECK_FALSE(Handler::isEqual(lhs, rhs, noChild));
+  }
+
+  SUBCASE("Children") {
+    ASTContext ctx;
+    ctx.GetOrRegisterASTSet<TestASTSet>();
+    auto one = Integer::create({}, &ctx, 1);
+    auto otherOne = Integer::create({}, &ctx, 1);
+
+    // identical children are not compared
+    unsigned numCompared = 0;
+    auto childEqual = [&](AST lhs, AST rhs) {
+      ++numCompared;
+      return lhs.isEqual(rhs);
+    };
+    using Handler = detail::ASTDataHandler<std::vector<AST>>;
+    CHECK(Handler::isEqual({one, one, otherOne}, {one, otherOne, otherOne},
+                           childEqual));
+    CHECK_EQ(numCompared, 1);
+  }
+}
+
+TEST_CASE("AST Shared Equality Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  // 2^40 paths from the root to the leaf
+  auto buildDAG = [&](std::int64_t leafValue) {
+    AST node = Integer::create({}, &ctx, leafValue);
+    for (unsigned depth = 0; depth < 40; ++depth)
+      node = TestBlock::create({}, &ctx, std::vector<AST>{node, node});
+    return node;
+  };
+  auto lhs = buildDAG(1);
+  auto rhs = buildDAG(1);
+  auto different = buildDAG(2);
+
+  CHECK(lhs.isEqual(lhs));
+  CHECK(lhs.isEqualMemoized(rhs));
+  CHECK_FALSE(lhs.isEqualMemoized(different));
+  CHECK_FALSE(lhs.isEqual(AST()));
+  CHECK(AST().isEqual(AST()));
+}
+
+TEST_CASE("AST Parallel Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ctx.EnableSummaries();
+
+  auto buildForest = [&](std::int64_t lastValue) {
+    std::vector<AST> blocks;
+    for (std::int64_t block = 0; block < 64; ++block) {
+      std::vector<AST> stmts;
+      for (std::int64_t stmt = 0; stmt < 64; ++stmt)
+        stmts.push_back(Integer::create({}, &ctx, block * stmt));
+      blocks.push_back(TestBlock::create({}, &ctx, std::move(stmts)));
+    }
+    blocks.push_back(Integer::create({}, &ctx, lastValue));
+    return TestBlock::create({}, &ctx, std::move(blocks));
+  };
+  auto lhs = buildForest(0);
+  auto rhs = buildForest(0);
+  auto different = buildForest(1);
+
+  llvm::ThreadPool pool(llvm::hardware_concurrency(4));
+  ASTParallel parallel(pool);
+  parallel.setMinSubtreeSize(128);
+
+  CHECK(parallel.isEqual(lhs, rhs));
+  CHECK_EQ(parallel.getNumTasks(), 65);
+  CHECK_FALSE(parallel.isEqual(lhs, different));
+  CHECK(parallel.isEqual(lhs, lhs));
+
+  CHECK_EQ(parallel.hash(lhs), lhs.hash());
+  CHECK_EQ(parallel.hash(lhs), parallel.hash(rhs));
+  CHECK_NE(parallel.hash(lhs), parallel.hash(different));
+
+  // without a minimum size the split stops at a few tasks per thread
+  parallel.setMinSubtreeSize(0);
+  CHECK(parallel.isEqual(lhs, rhs));
+  CHECK_GT(parallel.getNumTasks(), 1);
+  CHECK_EQ(parallel.hash(rhs), rhs.hash());
+}
+
+TEST_CASE("AST Generator Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto range = TestRange::create({}, &ctx, one, two);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{range, two});
+  auto testFor = TestFor::create({}, &ctx, "i", one, two, one, block);
+
+  auto ids = [](ASTGenerator<AST> nodes) {
+    std::vector<ID> result;
+    for (AST node : nodes)
+      result.push_back(node.getID());
+    return result;
+  };
+  auto forID = ID::get<TestFor>();
+  auto blockID = ID::get<TestBlock>();
+  auto rangeID = ID::get<TestRange>();
+  auto intID = ID::get<Integer>();
+
+  std::vector<ID> preOrder{forID,   intID, intID, intID, blockID,
+                           rangeID, intID, intID, intID};
+  CHECK_EQ(ids(generatePreOrder(testFor)), preOrder);
+  std::vector<ID> postOrder{intID, intID, rangeID, intID, blockID};
+  CHECK_EQ(ids(generatePostOrder(block)), postOrder);
+  CHECK(ids(generatePreOrder(AST())).empty());
+
+  SUBCASE("Kinds") {
+    std::vector<std::int64_t> values;
+    for (auto integer : generateKind<Integer>(block))
+      values.push_back(integer.getValue());
+    CHECK_EQ(values, std::vector<std::int64_t>({1, 2, 2}));
+
+    unsigned numRanges = 0;
+    for (auto nested : generateKind<TestRange>(testFor)) {
+      CHECK_EQ(nested, range);
+      ++numRanges;
+    }
+    CHECK_EQ(numRanges, 1);
+  }
+
+  SUBCASE("Pipeline") {
+    // stops pulling after the first match
+    unsigned numPulled = 0;
+    auto counted = transform(generatePreOrder(testFor), [&](AST node) {
+      ++numPulled;
+      return node;
+    });
+    auto blocks = filter(std::move(counted),
+                         [](AST node) { return node.isa<TestBlock>(); });
+    auto values = transform(std::move(blocks), [](AST node) {
+      return node.cast<TestBlock>().getStmts().size();
+    });
+    auto it = values.begin();
+    REQUIRE(it != values.end());
+    CHECK_EQ(*it, 2);
+    CHECK_EQ(numPulled, 5);
+  }
+}
+
+TEST_CASE("AST Fused Walker Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto two = Integer::create({}, &ctx, 2);
+  auto three = Integer::create({}, &ctx, 3);
+  auto inner = TestBlock::create({}, &ctx, std::vector<AST>{two, three});
+  auto outer = TestBlock::create({}, &ctx, std::vector<AST>{one, inner, three});
+
+  auto valueOf = [](AST ast) -> std::int64_t {
+    return ast.isa<Integer>() ? ast.cast<Integer>().getValue() : 0;
+  };
+
+  ASTFusedWalker walker;
+  // every node, both ways
+  std::vector<std::int64_t> pre, post;
+  walker.addPass(
+      [&](AST ast) {
+        pre.push_back(valueOf(ast));
+        return WalkResult::success();
+      },
+      [&](AST ast) {
+        post.push_back(valueOf(ast));
+        return WalkResult::success();
+      });
+  // does not enter the inner block
+  std::vector<std::int64_t> skipping;
+  walker.addPass([&](AST ast) {
+    skipping.push_back(valueOf(ast));
+    return ast == inner ? WalkResult::skip() : WalkResult::success();
+  });
+  // stops at the first 2
+  std::vector<std::int64_t> interrupting;
+  unsigned interruptingPass = walker.addPass(nullptr, [&](AST ast) {
+    interrupting.push_back(valueOf(ast));
+    return valueOf(ast) == 2 ? WalkResult::interrupt() : WalkResult::success();
+  });
+
+  walker.Walk(outer);
+  // the shared 3 is visited once per pass, where the pass first sees it
+  CHECK_EQ(pre, std::vector<std::int64_t>({0, 1, 0, 2, 3}));
+  CHECK_EQ(post, std::vector<std::int64_t>({1, 2, 3, 0, 0}));
+  CHECK_EQ(skipping, std::vector<std::int64_t>({0, 1, 0, 3}));
+  CHECK_EQ(interrupting, std::vector<std::int64_t>({1, 2}));
+  CHECK(walker.isInterrupted(interruptingPass));
+  CHECK_FALSE(walker.isInterrupted(0));
+
+  // a DAG of 2^32 paths is walked in linear time
+  AST dag = one;
+  for (unsigned depth = 0; depth < 32; ++depth)
+    dag = TestBlock::create({}, &ctx, std::vector<AST>{dag, dag});
+  ASTFusedWalker dagWalker;
+  unsigned numVisited = 0;
+  dagWalker.addPass([&](AST) {
+    ++numVisited;
+    return WalkResult::success();
+  });
+  dagWalker.Walk(dag);
+  CHECK_EQ(numVisited, 33);
+
+  // a node of another context shares its index with `one`
+  ASTContext other;
+  other.GetOrRegisterASTSet<TestASTSet>();
+  auto foreign = Integer::create({}, &other, 4);
+  CHECK_EQ(foreign.getIndex(), one.getIndex());
+  numVisited = 0;
+  dagWalker.Walk(TestBlock::create({}, &ctx,
+                                   std::vector<AST>{one, foreign, foreign}));
+  CHECK_EQ(numVisited, 3);
+}
+
+TEST_CASE("AST Region Test" * doctest::test_suite("ast test suite")) {
+  ASTContext ctx;
+  ctx.GetOrRegisterASTSet<TestASTSet>();
+  ctx.EnableChangeTracking();
+  ctx.EnableRegionChecks();
+
+  auto one = Integer::create({}, &ctx, 1);
+  auto block = TestBlock::create({}, &ctx, std::vector<AST>{one, one});
+  auto &table = ctx.GetOrCreateSideTable<SubtreeSizeTable>();
+  auto before = ctx.getAllocatedBytes();
+
+  {
+    ASTContext::Region outer(&ctx);
+    auto temp = TestBlock::create({}, &ctx, std::vector<AST>{one, block});
+    CHECK(outer.contains(temp));
+    CHECK_FALSE(outer.contains(block));
+    CHECK_EQ(table.get(temp), 5);
+
+    {
+      ASTContext::Region inner(&ctx);
+      for (std::uint64_t idx = 0; idx < 1024; ++idx)
+        TestBlock::create({}, &ctx,
+                          std::vector<AST>{Integer::create({}, &ctx, idx)});
+      CHECK_GT(inner.getAllocatedBytes(), 0);
+      CHECK_FALSE(inner.contains(temp));
+      CHECK_GE(ctx.getAllocatedBytes(), before + inner.getAllocatedBytes());
+    }
+    CHECK_EQ(table.get(temp), 5);
+    CHECK_EQ(ctx.getAllocatedBytes(), before + outer.getAllocatedBytes());
+  }
+
+  CHECK_EQ(ctx.getAllocatedBytes(), before);
+  CHECK_EQ(block.toString(), "{\n  1\n  1\n}");
+  CHECK_EQ(table.get(block), 3);
+
+  // parent links into the region are gone
+  one.remapChildren([](AST ast) { return ast; });
+  CHECK(block.isSubtreeDirty());
+}
+
 } // namespace ast::test
@@ -6,6 +6,7 @@
 DEFINE_TYPE_ID(ast::test::TestASTSet)
 DEFINE_TYPE_ID(ast::test::TestAST1)
 DEFINE_TYPE_ID(ast::test::TestIf)
+DEFINE_TYPE_ID(ast::test::SubtreeSizeTable)
 
 namespace ast::test {
 
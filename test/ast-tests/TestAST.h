@@ -3,6 +3,7 @@
 
 #include "ast/AST.h"
 #include "ast/ASTSet.h"
+#include "ast/ASTSideTable.h"
 #include "ast/ASTTypeID.h"
 
 namespace ast::test {
@@ -61,6 +62,8 @@ public:
   AST getThenBranch() const { return thenBranch; }
   AST getElseBranch() const { return elseBranch; }
 
+  auto traversalOrder() { return std::tie(condition, thenBranch, elseBranch); }
+
 private:
   friend class ::ast::ASTBuilder;
   friend class ::ast::ASTContext;
@@ -95,10 +98,25 @@ public:
   static void print(TestIf ast, ASTPrinter &printer);
 };
 
+class SubtreeSizeTable : public ASTSideTable<SubtreeSizeTable, std::size_t> {
+public:
+  using Base::Base;
+
+  std::size_t compute(AST ast) {
+    ++numComputed;
+    std::size_t size = 1;
+    ast.walkChildren([&](AST child) { size += get(child); });
+    return size;
+  }
+
+  std::size_t numComputed = 0;
+};
+
 } // namespace ast::test
 
 DECLARE_TYPE_ID(ast::test::TestASTSet)
 DECLARE_TYPE_ID(ast::test::TestAST1)
 DECLARE_TYPE_ID(ast::test::TestIf)
+DECLARE_TYPE_ID(ast::test::SubtreeSizeTable)
 
 #endif // TEST_AST_H
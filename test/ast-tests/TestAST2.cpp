@@ -26,4 +26,42 @@ void Integer::print(Integer integer, ASTPrinter &printer) {
   printer.OS() << integer.getValue();
 }
 
+void TestBlock::print(TestBlock block, ASTPrinter &printer) {
+  printer.OS() << "{";
+  {
+    ASTPrinter::AddIndentScope scope(printer, 2);
+    for (AST stmt : block.getStmts()) {
+      printer.Line();
+      stmt.print(printer);
+    }
+  }
+  printer.Line() << "}";
+}
+
+void TestRange::print(TestRange range, ASTPrinter &printer) {
+  range.getLower().print(printer);
+  printer.OS() << "..";
+  range.getUpper().print(printer);
+}
+
+void TestCounted::print(TestCounted, ASTPrinter &printer) {
+  printer.OS() << "counted";
+}
+
+void TestScope::print(TestScope scope, ASTPrinter &printer) {
+  printer.OS() << "scope {";
+  {
+    ASTPrinter::AddIndentScope indent(printer, 2);
+    for (const auto &[name, value] : scope.getSymbols()) {
+      printer.Line() << name << " = ";
+      value.print(printer);
+    }
+  }
+  printer.Line() << "} -> ";
+  if (const auto *name = std::get_if<std::string>(&scope.getResult()))
+    printer.OS() << *name;
+  else
+    std::get<AST>(scope.getResult()).print(printer);
+}
+
 } // namespace ast::test
@@ -2,8 +2,54 @@
 #define TEST_AST2_H
 
 #include "ast/AST.h"
+#include "ast/ASTMatcher.h"
+
+namespace ast::test {
+
+/// A tree member counting how often it is copied and moved.
+struct CopyCounter {
+  CopyCounter() = default;
+  CopyCounter(const CopyCounter &) { ++numCopies; }
+  CopyCounter(CopyCounter &&) noexcept { ++numMoves; }
+  CopyCounter &operator=(const CopyCounter &) {
+    ++numCopies;
+    return *this;
+  }
+  CopyCounter &operator=(CopyCounter &&) noexcept {
+    ++numMoves;
+    return *this;
+  }
+
+  static void reset() { numCopies = numMoves = 0; }
+
+  static inline unsigned numCopies = 0;
+  static inline unsigned numMoves = 0;
+};
+
+} // namespace ast::test
+
+namespace ast::detail {
+
+template <> struct ASTDataHandler<test::CopyCounter> {
+  using Counter = test::CopyCounter;
+
+  static bool isEqual(const Counter &, const Counter &, const ChildEqualFn &) {
+    return true;
+  }
+  static llvm::hash_code hash(const Counter &, const ChildHashFn &) {
+    return llvm::hash_value(0);
+  }
+  static void walk(const Counter &, const std::function<void(AST)> &) {}
+  static void remap(Counter &, const std::function<AST(AST)> &) {}
+  static bool findChild(const Counter &, std::size_t &, AST &) { return false; }
+};
+
+} // namespace ast::detail
 
 #define AST_TABLEGEN_DECL
 #include "TestAST2.hpp.inc"
 
+#define AST_TABLEGEN_PATTERN
+#include "TestAST2Pattern.hpp.inc"
+
 #endif // TEST_AST2_H
@@ -25,6 +25,26 @@ public:
     testFor.getBodyE().accept(*this);
   }
 
+  void visit(TestBlock block) {
+    OS << "visit TestBlock\n";
+    for (AST stmt : block.getStmts())
+      stmt.accept(*this);
+  }
+
+  void visit(TestScope scope) {
+    OS << "visit TestScope\n";
+    for (const auto &[name, value] : scope.getSymbols())
+      value.accept(*this);
+  }
+
+  void visit(TestRange range) {
+    OS << "visit TestRange\n";
+    range.getLower().accept(*this);
+    range.getUpper().accept(*this);
+  }
+
+  void visit(TestCounted) { OS << "visit TestCounted\n"; }
+
 private:
   llvm::raw_ostream &OS;
 };
@@ -111,6 +111,8 @@ bool ASTDefGenMain(llvm::raw_ostream &OS, llvm::RecordKeeper &Records) {
       defModel->getASTImplCreateFunction()->print(printer);
       defModel->getASTImplConstructor()->print(printer.PrintLine());
       defModel->getASTCreateFunction()->print(printer.PrintLine());
+      if (auto *descendantKindsFunc = defModel->getDescendantKindsFunction())
+        descendantKindsFunc->print(printer.PrintLine());
       printer.OS() << defModel->getExtraClassDefinition();
       printer.Line();
     }
@@ -119,6 +121,38 @@ bool ASTDefGenMain(llvm::raw_ostream &OS, llvm::RecordKeeper &Records) {
   return false; /// exit code 0
 }
 
+bool ASTPatternGenMain(llvm::raw_ostream &OS, llvm::RecordKeeper &Records) {
+  TableGenEmitter E(OS, Records);
+  std::vector<llvm::Record *> patternRecords =
+      Records.getAllDerivedDefinitions("Pattern");
+
+  std::vector<std::unique_ptr<PatternModel>> patternModels;
+  patternModels.reserve(patternRecords.size());
+
+  for (auto *R : patternRecords) {
+    auto patternModel = PatternModel::create(&E, R);
+    if (!patternModel)
+      return true; /// exit code 1
+
+    patternModels.emplace_back(std::move(patternModel));
+  }
+
+  cxx::ComponentPrinter printer(OS);
+
+  /// Print pattern matcher functions
+  {
+    cxx::ComponentPrinter::DefineScope scope(printer, "AST_TABLEGEN_PATTERN");
+    for (const auto &patternModel : patternModels) {
+      cxx::ComponentPrinter::NamespaceScope namespaceScope(
+          printer, patternModel->getNamespaceName());
+      patternModel->getMatcherFunction()->print(printer);
+      printer.Line();
+    }
+  }
+
+  return false; /// exit code 0
+}
+
 TableGenEmitter::TableGenEmitter(llvm::raw_ostream &os,
                                  llvm::RecordKeeper &records)
     : os(os), records(records), context(new TableGenContext) {
@@ -129,6 +163,7 @@ TableGenEmitter::TableGenEmitter(llvm::raw_ostream &os,
   astSetType = cxx::RawType::create(context, "::ast::ASTSet", {});
   voidType = cxx::RawType::create(context, "void", {});
   autoType = cxx::RawType::create(context, "auto", {});
+  autoRefType = cxx::ReferenceType::create(context, autoType);
   constAutoRefType = cxx::createConstReferenceType(context, autoType);
   astBuilderType = cxx::RawType::create(context, "::ast::ASTBuilder", {});
   astPrinterRef = cxx::ReferenceType::create(
@@ -289,4 +324,163 @@ TableGenEmitter::getTypePairByDefInit(const llvm::DefInit *defInit) {
       llvm::formatv("Unsupported record type: {0}", record->getName()));
 }
 
+static bool isScalarType(llvm::StringRef type) {
+  static constexpr llvm::StringLiteral scalarTypes[] = {
+      "size_t",           "bool",           "::std::int8_t",
+      "::std::int16_t",   "::std::int32_t", "::std::int64_t",
+      "::std::uint8_t",   "::std::uint16_t", "::std::uint32_t",
+      "::std::uint64_t",  "char",           "short",
+      "int",              "long",           "long long",
+      "unsigned char",    "unsigned short", "unsigned int",
+      "unsigned long",    "unsigned long long", "float",
+      "double",           "long double"};
+  return llvm::is_contained(scalarTypes, type);
+}
+
+TableGenEmitter::ChildKind
+TableGenEmitter::getChildKind(const llvm::Init *init) {
+  const auto *defInit = llvm::dyn_cast<llvm::DefInit>(init);
+  if (!defInit)
+    return ChildKind::Nested;
+
+  auto *record = defInit->getDef();
+  if (record->getName() == "String")
+    return ChildKind::None;
+
+  if (record->isSubClassOf("UserDefineType")) {
+    llvm::StringRef paramType = record->getValueAsString("paramType");
+    if (paramType == astType->toString())
+      return ChildKind::Direct;
+    return isScalarType(paramType) ? ChildKind::None : ChildKind::Nested;
+  }
+
+  if (record->isSubClassOf("Vector") || record->isSubClassOf("SmallVector") ||
+      record->isSubClassOf("Optional")) {
+    switch (getChildKind(record->getValueInit("elementType"))) {
+    case ChildKind::None:
+      return ChildKind::None;
+    case ChildKind::Direct:
+      return record->isSubClassOf("Optional") ? ChildKind::Optional
+                                              : ChildKind::Range;
+    default:
+      return ChildKind::Nested;
+    }
+  }
+
+  llvm::SmallVector<const llvm::Init *> elementInits;
+  if (record->isSubClassOf("Tuple") || record->isSubClassOf("Variant")) {
+    llvm::ListInit *listInit = record->getValueAsListInit("elementTypes");
+    elementInits.append(listInit->begin(), listInit->end());
+  } else if (record->isSubClassOf("Pair")) {
+    elementInits.push_back(record->getValueInit("firstType"));
+    elementInits.push_back(record->getValueInit("secondType"));
+  } else if (record->isSubClassOf("Map")) {
+    elementInits.push_back(record->getValueInit("keyType"));
+    elementInits.push_back(record->getValueInit("valueType"));
+  } else {
+    return ChildKind::Nested;
+  }
+
+  return llvm::all_of(elementInits,
+                      [&](const llvm::Init *elementInit) {
+                        return getChildKind(elementInit) == ChildKind::None;
+                      })
+             ? ChildKind::None
+             : ChildKind::Nested;
+}
+
+/// Collects the AST defs a tree member of format `init` may hold directly.
+/// Returns false if it may hold any AST.
+bool TableGenEmitter::collectChildKinds(
+    const llvm::Init *init, llvm::SetVector<llvm::Record *> &kinds) {
+  const auto *defInit = llvm::dyn_cast<llvm::DefInit>(init);
+  if (!defInit)
+    return getChildKind(init) == ChildKind::None;
+
+  auto *record = defInit->getDef();
+  if (record->isSubClassOf("ASTTypeOf")) {
+    for (auto *kind : record->getValueAsListOfDefs("kinds"))
+      kinds.insert(kind);
+    return true;
+  }
+
+  switch (getChildKind(init)) {
+  case ChildKind::None:
+    return true;
+  case ChildKind::Direct:
+    return false;
+  default:
+    break;
+  }
+
+  llvm::SmallVector<const llvm::Init *> elementInits;
+  if (record->isSubClassOf("Vector") || record->isSubClassOf("SmallVector") ||
+      record->isSubClassOf("Optional")) {
+    elementInits.push_back(record->getValueInit("elementType"));
+  } else if (record->isSubClassOf("Tuple") || record->isSubClassOf("Variant")) {
+    llvm::ListInit *listInit = record->getValueAsListInit("elementTypes");
+    elementInits.append(listInit->begin(), listInit->end());
+  } else if (record->isSubClassOf("Pair")) {
+    elementInits.push_back(record->getValueInit("firstType"));
+    elementInits.push_back(record->getValueInit("secondType"));
+  } else if (record->isSubClassOf("Map")) {
+    elementInits.push_back(record->getValueInit("keyType"));
+    elementInits.push_back(record->getValueInit("valueType"));
+  } else {
+    return false;
+  }
+
+  return llvm::all_of(elementInits, [&](const llvm::Init *elementInit) {
+    return collectChildKinds(elementInit, kinds);
+  });
+}
+
+void TableGenEmitter::computeDescendantKinds() {
+  descendantKindsComputed = true;
+  std::vector<llvm::Record *> astRecords =
+      records.getAllDerivedDefinitions("AST");
+
+  /// start from the child kinds and close over them to a fixpoint
+  for (auto *record : astRecords) {
+    auto &kinds = descendantKinds[record];
+    llvm::DagInit *treeMember = record->getValueAsDag("treeMember");
+    for (auto idx = 0u; idx < treeMember->getNumArgs(); ++idx)
+      if (!collectChildKinds(treeMember->getArg(idx), kinds))
+        unboundedKinds.insert(record);
+  }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto *record : astRecords) {
+      if (unboundedKinds.contains(record))
+        continue;
+      auto &kinds = descendantKinds.find(record)->second;
+      llvm::SmallVector<llvm::Record *> children(kinds.begin(), kinds.end());
+      for (auto *child : children) {
+        if (unboundedKinds.contains(child)) {
+          unboundedKinds.insert(record);
+          changed = true;
+          break;
+        }
+        for (auto *descendant : descendantKinds.lookup(child))
+          changed |= kinds.insert(descendant);
+      }
+    }
+  }
+}
+
+std::optional<llvm::SmallVector<llvm::Record *>>
+TableGenEmitter::getDescendantKinds(llvm::Record *record) {
+  if (!descendantKindsComputed)
+    computeDescendantKinds();
+  if (unboundedKinds.contains(record))
+    return std::nullopt;
+
+  llvm::SmallVector<llvm::Record *> kinds(
+      descendantKinds.lookup(record).getArrayRef());
+  llvm::sort(kinds, llvm::LessRecord());
+  return kinds;
+}
+
 } // namespace ast::tblgen
@@ -3,6 +3,9 @@
 
 #include "CXXType.h"
 #include "TableGenContext.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
@@ -32,6 +35,26 @@ public:
   std::pair<TypePair, bool> getTypePair(const llvm::Init *init);
   std::pair<TypePair, bool> getTypePairByDefInit(const llvm::DefInit *defInit);
 
+  /// How a tree member holds AST children, used to emit specialized walks.
+  enum class ChildKind {
+    /// No AST inside.
+    None,
+    /// A single AST.
+    Direct,
+    /// A Vector or SmallVector of AST.
+    Range,
+    /// An Optional AST.
+    Optional,
+    /// Anything else that may hold AST; handled by ASTDataHandler.
+    Nested,
+  };
+  ChildKind getChildKind(const llvm::Init *init);
+
+  /// The AST defs that may occur below an AST of def `record`, sorted by
+  /// name, or std::nullopt if any AST may. Only ASTTypeOf members bound them.
+  std::optional<llvm::SmallVector<llvm::Record *>>
+  getDescendantKinds(llvm::Record *record);
+
   const cxx::Type *getASTType() const { return astType; }
   const cxx::Type *getASTImplType() const { return astImplType; }
   const cxx::Type *getASTContextType() const { return astContextType; }
@@ -42,11 +65,16 @@ public:
   const cxx::Type *getASTPrinterRef() const { return astPrinterRef; }
   const cxx::Type *getVoidType() const { return voidType; }
   const cxx::Type *getAutoType() const { return autoType; }
+  const cxx::Type *getAutoRefType() const { return autoRefType; }
   const cxx::Type *getConstAutoRefType() const { return constAutoRefType; }
   const cxx::Type *getASTBuilderType() const { return astBuilderType; }
   const cxx::Type *getllmvSMRangeType() const { return llvmSMRangeType; }
 
 private:
+  bool collectChildKinds(const llvm::Init *init,
+                         llvm::SetVector<llvm::Record *> &kinds);
+  void computeDescendantKinds();
+
   llvm::raw_ostream &os;
   llvm::RecordKeeper &records;
   TableGenContext *context;
@@ -59,9 +87,15 @@ private:
   const cxx::Type *astPrinterRef;
   const cxx::Type *voidType;
   const cxx::Type *autoType;
+  const cxx::Type *autoRefType;
   const cxx::Type *constAutoRefType;
   const cxx::Type *astBuilderType;
   const cxx::Type *llvmSMRangeType;
+
+  bool descendantKindsComputed = false;
+  llvm::DenseMap<llvm::Record *, llvm::SetVector<llvm::Record *>>
+      descendantKinds;
+  llvm::DenseSet<llvm::Record *> unboundedKinds;
 };
 
 } // namespace ast::tblgen
@@ -6,6 +6,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/TableGen/Error.h"
 #include <numeric>
 
 namespace ast::tblgen {
@@ -42,6 +43,36 @@ std::optional<DataModel> DataModel::create(TableGenEmitter *emitter,
   if (!tagSuccess)
     return std::nullopt;
 
+  auto getKindName = [](const llvm::Record *kind) {
+    return (kind->getValueAsString("namespace") + "::" +
+            kind->getName().split('_').second)
+        .str();
+  };
+
+  llvm::SmallVector<TableGenEmitter::ChildKind> childKinds;
+  llvm::SmallVector<std::optional<llvm::SmallVector<std::string>>>
+      memberKindNames;
+  childKinds.reserve(treeMember->getNumArgs());
+  for (auto idx = 0u; idx < treeMember->getNumArgs(); ++idx) {
+    const llvm::Init *arg = treeMember->getArg(idx);
+    childKinds.emplace_back(emitter->getChildKind(arg));
+
+    auto &kindNames = memberKindNames.emplace_back();
+    const auto *defInit = llvm::dyn_cast<llvm::DefInit>(arg);
+    if (defInit && defInit->getDef()->isSubClassOf("ASTTypeOf")) {
+      kindNames.emplace();
+      for (auto *kind : defInit->getDef()->getValueAsListOfDefs("kinds"))
+        kindNames->emplace_back(getKindName(kind));
+    }
+  }
+
+  std::optional<llvm::SmallVector<std::string>> descendantKindNames;
+  if (auto descendantKinds = emitter->getDescendantKinds(record)) {
+    descendantKindNames.emplace();
+    for (auto *kind : *descendantKinds)
+      descendantKindNames->emplace_back(getKindName(kind));
+  }
+
   return DataModel{
       .Emitter = emitter,
       .SetName = setName,
@@ -53,8 +84,11 @@ std::optional<DataModel> DataModel::create(TableGenEmitter *emitter,
       .ExtraClassDefinition = extraClassDef,
       .TreeMemberParamNames = paramNames,
       .TreeMemberTypePairs = typePairs,
+      .TreeMemberChildKinds = childKinds,
+      .TreeMemberKindNames = memberKindNames,
       .TagParamNames = tagParamNames,
       .TagTypePairs = tagTypePairs,
+      .DescendantKindNames = descendantKindNames,
   };
 }
 
@@ -129,8 +163,8 @@ createTagMemberSetterMethod(TableGenEmitter *emitter, std::size_t idx,
 
   auto setterBody = llvm::formatv("std::get<{0}>(astTag) = {1};", idx,
                                   cast2ParamTypeExpr(tagName, paramType));
-  cxx::Class::Method::InstanceAttribute setterAttr{.IsConst = false,
-                                                   .Body = {setterBody.str()}};
+  cxx::Class::Method::InstanceAttribute setterAttr{
+      .IsConst = false, .Body = {setterBody.str(), "markModified();"}};
   return cxx::Class::Method::create(emitter->getContext(),
                                     emitter->getVoidType(), setterName,
                                     {{tagName.str(), viewType}}, setterAttr);
@@ -225,12 +259,56 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
 
   /// traversal order
   cxx::Class::Method *traversalOrderMethod = nullptr;
+  cxx::Class::Method *mutableTraversalOrderMethod = nullptr;
   if (hasTreeMember) {
     traversalOrderMethod = cxx::Class::Method::create(
         emitter->getContext(), emitter->getConstAutoRefType(), "traversalOrder",
         std::nullopt,
         cxx::Class::Method::InstanceAttribute{
             .IsConst = true, .Body = {"return astTreeMember;"}});
+    /// mutable traversal order, used to remap children of a cloned impl
+    mutableTraversalOrderMethod = cxx::Class::Method::create(
+        emitter->getContext(), emitter->getAutoRefType(), "traversalOrder",
+        std::nullopt,
+        cxx::Class::Method::InstanceAttribute{
+            .IsConst = false, .Body = {"return astTreeMember;"}});
+  }
+
+  /// child offsets, for kinds whose children are all direct AST members
+  cxx::Class::Method *childOffsetsMethod = nullptr;
+  if (llvm::all_of(model.TreeMemberChildKinds, [](auto childKind) {
+        return childKind == TableGenEmitter::ChildKind::None ||
+               childKind == TableGenEmitter::ChildKind::Direct;
+      })) {
+    llvm::SmallVector<std::string> args;
+    llvm::SmallVector<std::string> offsets;
+    for (const auto &[idx, childKind, typePair] : llvm::enumerate(
+             model.TreeMemberChildKinds, model.TreeMemberTypePairs)) {
+      args.emplace_back(typePair.first->toString() + "{}");
+      if (childKind == TableGenEmitter::ChildKind::Direct)
+        offsets.emplace_back(llvm::formatv(
+            "static_cast<::std::uint32_t>(reinterpret_cast<const char "
+            "*>(&std::get<{0}>(impl.astTreeMember)) - base)",
+            idx));
+    }
+
+    cxx::BodyCode body;
+    if (offsets.empty()) {
+      body.emplace_back("return {};");
+    } else {
+      /// measured on a value-initialized impl
+      body.emplace_back(llvm::formatv("const {0} impl({1});", astImplName,
+                                      llvm::join(args, ", ")));
+      body.emplace_back("const char *base = reinterpret_cast<const char "
+                        "*>(static_cast<const ::ast::ASTImpl *>(&impl));");
+      body.emplace_back("return {" + llvm::join(offsets, ", ") + "};");
+    }
+    childOffsetsMethod = cxx::Class::Method::create(
+        emitter->getContext(),
+        cxx::RawType::create(emitter->getContext(),
+                             "::llvm::SmallVector<::std::uint32_t>", {}),
+        "getChildOffsets", std::nullopt,
+        cxx::Class::Method::StaticAttribute{.Body = body});
   }
 
   /// friend class
@@ -261,6 +339,66 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
       emitter->getContext(), astImplTypePointer, "create", createParams,
       cxx::Class::Method::StaticAttribute{});
 
+  /// forwarding constructor and create function. Each member whose view
+  /// type differs from its storage type is taken as a forwarding reference
+  /// constrained to what the storage type can be built from, so every rvalue
+  /// argument is moved into place and every lvalue copied once, whatever the
+  /// other arguments are.
+  llvm::SmallVector<std::string> forwardingTemplateParams;
+  llvm::SmallVector<std::string> forwardingConstraints;
+  llvm::SmallVector<std::string> forwardingParams;
+  llvm::SmallVector<std::string> forwardingArgs;
+  for (const auto &[paramName, typePair] :
+       llvm::zip(model.TreeMemberParamNames, model.TreeMemberTypePairs)) {
+    const auto &[paramType, viewType] = typePair;
+    if (paramType->toString() == viewType->toString()) {
+      forwardingParams.emplace_back(
+          llvm::formatv("{0} {1}", viewType->toString(), paramName));
+      forwardingArgs.emplace_back(paramName);
+      continue;
+    }
+    std::string templateParam = llvm::formatv(
+        "{0}{1}T", llvm::toUpper(paramName[0]), paramName.drop_front());
+    forwardingTemplateParams.emplace_back("typename " + templateParam);
+    forwardingConstraints.emplace_back(
+        llvm::formatv("::std::is_constructible_v<{0}, {1} &&>",
+                      paramType->toString(), templateParam));
+    forwardingParams.emplace_back(
+        llvm::formatv("{0} &&{1}", templateParam, paramName));
+    forwardingArgs.emplace_back(llvm::formatv("::std::forward<{0}>({1})",
+                                              templateParam, paramName));
+  }
+
+  bool hasForwardingParams = !forwardingTemplateParams.empty();
+  std::string forwardingTemplate;
+  std::string forwardingParamList;
+  std::string forwardingArgList;
+  cxx::Class::RawCode *forwardingConstructor = nullptr;
+  cxx::Class::RawCode *forwardingCreateMethod = nullptr;
+  if (hasForwardingParams) {
+    forwardingTemplate =
+        llvm::formatv("template <{0}> requires {1} ",
+                      llvm::join(forwardingTemplateParams, ", "),
+                      llvm::join(forwardingConstraints, " && "));
+    forwardingParamList = llvm::join(forwardingParams, ", ");
+    forwardingArgList = llvm::join(forwardingArgs, ", ");
+
+    forwardingConstructor = cxx::Class::RawCode::create(
+        emitter->getContext(),
+        llvm::formatv("{0}{1}({2}) : astTreeMember({3}) {{}",
+                      forwardingTemplate, astImplName, forwardingParamList,
+                      forwardingArgList)
+            .str());
+    forwardingCreateMethod = cxx::Class::RawCode::create(
+        emitter->getContext(),
+        llvm::formatv("{0}static {1} create({2} context, {3}) {{ return "
+                      "context->Alloc<{4}>({5}); }",
+                      forwardingTemplate, astImplTypePointer->toString(),
+                      emitter->getASTContextPointerType()->toString(),
+                      forwardingParamList, astImplName, forwardingArgList)
+            .str());
+  }
+
   /// private block
   llvm::SmallVector<cxx::Class::ClassMember> privateMembers;
   privateMembers.emplace_back(friendASTContext);
@@ -268,6 +406,10 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
   privateMembers.emplace_back(friendAST);
   privateMembers.emplace_back(constructor);
   privateMembers.emplace_back(createMethod);
+  if (hasForwardingParams) {
+    privateMembers.emplace_back(forwardingConstructor);
+    privateMembers.emplace_back(forwardingCreateMethod);
+  }
   if (hasTreeMember)
     privateMembers.emplace_back(treeMemberDecl);
   if (hasTag)
@@ -280,8 +422,11 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
   llvm::SmallVector<cxx::Class::ClassMember> publicMembers;
   if (hasTreeMember) {
     publicMembers.emplace_back(traversalOrderMethod);
+    publicMembers.emplace_back(mutableTraversalOrderMethod);
     publicMembers.append(treeMemberGetters.begin(), treeMemberGetters.end());
   }
+  if (childOffsetsMethod)
+    publicMembers.emplace_back(childOffsetsMethod);
   if (hasTag) {
     publicMembers.append(tagGetters.begin(), tagGetters.end());
     publicMembers.append(tagSetters.begin(), tagSetters.end());
@@ -382,6 +527,154 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
             .IsConst = true, .Body = {"return getImpl()->traversalOrder();"}});
   }
 
+  /// specialized children walk and equality, used instead of the generic
+  /// traversal order recursion
+  cxx::Class::Method *astWalkMembersMethod = nullptr;
+  cxx::Class::Method *astIsEqualMembersMethod = nullptr;
+  cxx::Class::Method *astNumChildrenMethod = nullptr;
+  cxx::Class::Method *astChildMethod = nullptr;
+  if (hasTreeMember) {
+    using ChildKind = TableGenEmitter::ChildKind;
+    cxx::BodyCode walkBody;
+    cxx::BodyCode numChildrenBody;
+    cxx::BodyCode childBody;
+    unsigned numDirect = 0;
+    bool endsWithDecrement = false;
+    llvm::SmallVector<std::string> dataConds;
+    llvm::SmallVector<std::string> childConds;
+
+    for (const auto &[idx, childKind, typePair] : llvm::enumerate(
+             model.TreeMemberChildKinds, model.TreeMemberTypePairs)) {
+      std::string member = llvm::formatv("std::get<{0}>(members)", idx);
+      std::string lhs = llvm::formatv("std::get<{0}>(lhsMembers)", idx);
+      std::string rhs = llvm::formatv("std::get<{0}>(rhsMembers)", idx);
+      std::string handler =
+          llvm::formatv("::ast::detail::ASTDataHandler<{0}>",
+                        typePair.first->toString());
+
+      switch (childKind) {
+      case ChildKind::None:
+        dataConds.emplace_back(llvm::formatv("{0} == {1}", lhs, rhs));
+        continue;
+      case ChildKind::Direct:
+        walkBody.emplace_back(llvm::formatv("fn({0});", member));
+        ++numDirect;
+        childBody.emplace_back(
+            llvm::formatv("if (idx == 0) return {0};", member));
+        childBody.emplace_back("--idx;");
+        endsWithDecrement = true;
+        childConds.emplace_back(llvm::formatv(
+            "({0} == {1} || childEqual({0}, {1}))", lhs, rhs));
+        continue;
+      case ChildKind::Range:
+        walkBody.emplace_back(
+            llvm::formatv("for (const auto &child : {0}) fn(child);", member));
+        numChildrenBody.emplace_back(
+            llvm::formatv("count += {0}.size();", member));
+        childBody.emplace_back(
+            llvm::formatv("if (idx < {0}.size()) return {0}[idx];", member));
+        childBody.emplace_back(llvm::formatv("idx -= {0}.size();", member));
+        endsWithDecrement = true;
+        break;
+      case ChildKind::Optional:
+        walkBody.emplace_back(
+            llvm::formatv("if ({0}) fn(*{0});", member));
+        numChildrenBody.emplace_back(
+            llvm::formatv("count += {0} ? 1 : 0;", member));
+        childBody.emplace_back(llvm::formatv(
+            "if ({0}) {{ if (idx == 0) return *{0}; --idx; }", member));
+        endsWithDecrement = false;
+        break;
+      case ChildKind::Nested:
+        walkBody.emplace_back(
+            llvm::formatv("{0}::walk({1}, fn);", handler, member));
+        numChildrenBody.emplace_back(llvm::formatv(
+            "{0}::walk({1}, [&count](::ast::AST) {{ ++count; });", handler,
+            member));
+        childBody.emplace_back(llvm::formatv(
+            "if (::ast::AST child; {0}::findChild({1}, idx, child)) "
+            "return child;",
+            handler, member));
+        endsWithDecrement = false;
+        break;
+      }
+      childConds.emplace_back(llvm::formatv("{0}::isEqual({1}, {2}, childEqual)",
+                                            handler, lhs, rhs));
+    }
+
+    /// kinds without AST members leave the unused parameters unnamed
+    bool hasChildren = !walkBody.empty();
+    if (hasChildren)
+      walkBody.insert(walkBody.begin(),
+                      "const auto &members = ast.getImpl()->traversalOrder();");
+    astWalkMembersMethod = cxx::Class::Method::create(
+        emitter->getContext(), emitter->getVoidType(), "walkASTMembers",
+        {{hasChildren ? "ast" : "", astType},
+         {hasChildren ? "fn" : "", cxx::RawType::create(emitter->getContext(),
+                                     "::llvm::function_ref<void(::ast::AST)>",
+                                     {})}},
+        cxx::Class::Method::StaticAttribute{.Body = walkBody});
+
+    /// indexed child access, for kinds not served by a child offset table
+    if (!childOffsetsMethod) {
+      numChildrenBody.insert(
+          numChildrenBody.begin(),
+          {"const auto &members = ast.getImpl()->traversalOrder();",
+           llvm::formatv("::std::size_t count = {0};", numDirect).str()});
+      numChildrenBody.emplace_back("return count;");
+      astNumChildrenMethod = cxx::Class::Method::create(
+          emitter->getContext(),
+          cxx::RawType::create(emitter->getContext(), "::std::size_t", {}),
+          "getNumASTChildren", {{"ast", astType}},
+          cxx::Class::Method::StaticAttribute{.Body = numChildrenBody});
+
+      childBody.insert(childBody.begin(),
+                       "const auto &members = ast.getImpl()->traversalOrder();");
+      /// the index is not used after the last member
+      if (endsWithDecrement)
+        childBody.pop_back();
+      childBody.emplace_back("llvm_unreachable(\"Invalid child index\");");
+      astChildMethod = cxx::Class::Method::create(
+          emitter->getContext(),
+          cxx::RawType::create(emitter->getContext(), "::ast::AST", {}),
+          "getASTChild",
+          {{"ast", astType},
+           {"idx", cxx::RawType::create(emitter->getContext(), "::std::size_t",
+                                        {})}},
+          cxx::Class::Method::StaticAttribute{.Body = childBody});
+    }
+
+    /// plain data is compared before children
+    bool comparesChildren = !childConds.empty();
+    dataConds.append(childConds.begin(), childConds.end());
+    astIsEqualMembersMethod = cxx::Class::Method::create(
+        emitter->getContext(), cxx::RawType::create(emitter->getContext(),
+                                                    "bool", {}),
+        "isEqualASTMembers",
+        {{"lhs", astType},
+         {"rhs", astType},
+         {comparesChildren ? "childEqual" : "",
+          cxx::createConstReferenceType(
+              emitter->getContext(),
+              cxx::RawType::create(emitter->getContext(),
+                                   "::ast::detail::ChildEqualFn", {}))}},
+        cxx::Class::Method::StaticAttribute{
+            .Body = cxx::BodyCode{
+                "const auto &lhsMembers = lhs.getImpl()->traversalOrder();",
+                "const auto &rhsMembers = rhs.getImpl()->traversalOrder();",
+                "return " + llvm::join(dataConds, " && ") + ";"}});
+  }
+
+  /// kinds reachable below this one, defined with the type ids
+  cxx::Class::Method *astDescendantKindsMethod = nullptr;
+  if (model.DescendantKindNames)
+    astDescendantKindsMethod = cxx::Class::Method::create(
+        emitter->getContext(),
+        cxx::RawType::create(emitter->getContext(),
+                             "::llvm::SmallVector<::ast::ID>", {}),
+        "getDescendantKinds", std::nullopt,
+        cxx::Class::Method::StaticAttribute{});
+
   /// print method
   cxx::Class::Method *astPrintMethod = cxx::Class::Method::create(
       emitter->getContext(), emitter->getVoidType(), "print",
@@ -397,6 +690,21 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
       emitter->getContext(), astType, "create", astCreateParam,
       cxx::Class::Method::StaticAttribute{});
 
+  /// forwarding create function. It is taken whenever it is viable; the view
+  /// taking one remains for arguments that cannot be deduced, e.g. braced
+  /// initializer lists.
+  cxx::Class::RawCode *astForwardingCreateFunc = nullptr;
+  if (hasForwardingParams)
+    astForwardingCreateFunc = cxx::Class::RawCode::create(
+        emitter->getContext(),
+        llvm::formatv("{0}static {1} create({2} loc, {3} context, {4}) {{ "
+                      "return Base::create(loc, context, {5}); }",
+                      forwardingTemplate, astType->toString(),
+                      emitter->getllmvSMRangeType()->toString(),
+                      emitter->getASTContextPointerType()->toString(),
+                      forwardingParamList, forwardingArgList)
+            .str());
+
   /// public block
   llvm::SmallVector<cxx::Class::ClassMember> astPublicMembers;
 
@@ -409,11 +717,22 @@ std::unique_ptr<ASTDeclModel> ASTDeclModel::create(const DataModel &model) {
     astPublicMembers.append(astTagGetters.begin(), astTagGetters.end());
     astPublicMembers.append(astTagSetters.begin(), astTagSetters.end());
   }
-  if (hasTreeMember)
+  if (hasTreeMember) {
     astPublicMembers.emplace_back(astTraversalOrderMethod);
+    astPublicMembers.emplace_back(astWalkMembersMethod);
+    astPublicMembers.emplace_back(astIsEqualMembersMethod);
+  }
+  if (astChildMethod) {
+    astPublicMembers.emplace_back(astNumChildrenMethod);
+    astPublicMembers.emplace_back(astChildMethod);
+  }
+  if (astDescendantKindsMethod)
+    astPublicMembers.emplace_back(astDescendantKindsMethod);
 
   astPublicMembers.emplace_back(astPrintMethod);
   astPublicMembers.emplace_back(astCreateFunc);
+  if (astForwardingCreateFunc)
+    astPublicMembers.emplace_back(astForwardingCreateFunc);
 
   /// extra class declaration
   if (!model.ExtraClassDeclaration.empty()) {
@@ -491,13 +810,25 @@ std::unique_ptr<ASTDefModel> ASTDefModel::create(const DataModel &model) {
   for (const auto &paramName : model.TreeMemberParamNames)
     ss << ", " << paramName;
 
-  auto createBody =
-      llvm::formatv("return Base::create(loc, context{0});", arguments);
+  /// ASTTypeOf members must hold one of their kinds, or typed walks would
+  /// prune subtrees holding matches
+  cxx::BodyCode createBody;
+  for (const auto &[paramName, kindNames] :
+       llvm::zip(model.TreeMemberParamNames, model.TreeMemberKindNames)) {
+    if (!kindNames)
+      continue;
+    createBody.emplace_back(llvm::formatv(
+        "assert((!{0} || {0}.isa<{1}>()) && \"{0} must be one of the kinds "
+        "of its ASTTypeOf\");",
+        paramName, llvm::join(*kindNames, ", ")));
+  }
+  createBody.emplace_back(
+      llvm::formatv("return Base::create(loc, context{0});", arguments));
 
   auto *astCreateFunc = cxx::Function::create(
       emitter->getContext(), std::nullopt, cxx::Function::Access::None, astType,
       llvm::SmallVector<std::string>{model.ASTName.str()}, "create",
-      createParam, cxx::BodyCode{createBody.str()});
+      createParam, createBody);
 
   /// ast impl create function
   llvm::SmallVector<cxx::DeclPair> implCreateParam{
@@ -517,11 +848,18 @@ std::unique_ptr<ASTDefModel> ASTDefModel::create(const DataModel &model) {
   std::string initializeExpr;
   llvm::raw_string_ostream initExprStream(initializeExpr);
 
-  for (const auto &[idx, paramName, paramType] :
-       llvm::enumerate(model.TreeMemberParamNames, treeParamTypes)) {
+  for (const auto &[idx, paramName, paramType, viewType] : llvm::enumerate(
+           model.TreeMemberParamNames, treeParamTypes, treeViewTypes)) {
     if (idx != 0)
       initExprStream << ", ";
-    initExprStream << cast2ParamTypeExpr(paramName, paramType);
+    /// a const reference is copied into the tuple as is; a cast would copy
+    /// it into a temporary and then move that
+    if (viewType->toString() ==
+        cxx::createConstReferenceType(emitter->getContext(), paramType)
+            ->toString())
+      initExprStream << paramName;
+    else
+      initExprStream << cast2ParamTypeExpr(paramName, paramType);
   }
   initializerList.emplace_back("astTreeMember", initializeExpr);
 
@@ -533,10 +871,156 @@ std::unique_ptr<ASTDefModel> ASTDefModel::create(const DataModel &model) {
       cxx::ClassConstructor::create(emitter->getContext(), std::nullopt,
                                     astImplName, param, constructorImplement);
 
-  return std::unique_ptr<ASTDefModel>(
-      new ASTDefModel(model.ASTName, astImplName, model.Namespace,
-                      model.Description, model.ExtraClassDefinition,
-                      astImplCreateFunc, astImplConstructor, astCreateFunc));
+  /// descendant kinds
+  cxx::Function *descendantKindsFunc = nullptr;
+  if (model.DescendantKindNames) {
+    llvm::SmallVector<std::string> kindIDs;
+    for (const auto &kindName : *model.DescendantKindNames)
+      kindIDs.emplace_back(llvm::formatv("::ast::ID::get<{0}>()", kindName));
+    descendantKindsFunc = cxx::Function::create(
+        emitter->getContext(), std::nullopt, cxx::Function::Access::None,
+        cxx::RawType::create(emitter->getContext(),
+                             "::llvm::SmallVector<::ast::ID>", {}),
+        llvm::SmallVector<std::string>{model.ASTName.str()},
+        "getDescendantKinds", std::nullopt,
+        cxx::BodyCode{"return {" + llvm::join(kindIDs, ", ") + "};"});
+  }
+
+  return std::unique_ptr<ASTDefModel>(new ASTDefModel(
+      model.ASTName, astImplName, model.Namespace, model.Description,
+      model.ExtraClassDefinition, astImplCreateFunc, astImplConstructor,
+      astCreateFunc, descendantKindsFunc));
+}
+
+namespace {
+struct PatternMatcher {
+  std::string Expr;
+  const cxx::Type *KindType;
+};
+} // namespace
+
+static std::optional<PatternMatcher>
+createPatternMatcher(TableGenEmitter *emitter, const llvm::Record *pattern,
+                     const llvm::DagInit *dag,
+                     llvm::SmallVectorImpl<cxx::DeclPair> &bindings) {
+  const auto *opInit = llvm::dyn_cast<llvm::DefInit>(dag->getOperator());
+  if (!opInit || !opInit->getDef()->isSubClassOf("AST"))
+    llvm::PrintFatalError(pattern->getLoc(),
+                          llvm::formatv("Expected an AST def as the operator "
+                                        "of pattern dag: {0}",
+                                        dag->getAsString()));
+
+  auto dataModelOpt = DataModel::create(emitter, opInit->getDef());
+  if (!dataModelOpt)
+    return std::nullopt;
+  const DataModel &model = *dataModelOpt;
+
+  auto numMembers = model.TreeMemberParamNames.size();
+  if (dag->getNumArgs() != 0 && dag->getNumArgs() != numMembers)
+    llvm::PrintFatalError(
+        pattern->getLoc(),
+        llvm::formatv("Pattern on {0} expects {1} arguments, but got {2}",
+                      model.ASTName, numMembers, dag->getNumArgs()));
+
+  std::string kindName = (model.Namespace + "::" + model.ASTName).str();
+  std::string expr;
+  llvm::raw_string_ostream ss(expr);
+  ss << "::ast::match::m<" << kindName << ">(";
+  for (auto idx = 0u; idx < dag->getNumArgs(); ++idx) {
+    if (idx != 0)
+      ss << ", ";
+    const llvm::Init *arg = dag->getArg(idx);
+    llvm::StringRef memberName = model.TreeMemberParamNames[idx];
+    const cxx::Type *memberType = model.TreeMemberTypePairs[idx].first;
+    bool isASTMember =
+        memberType->toString() == emitter->getASTType()->toString();
+
+    std::string sub;
+    const cxx::Type *bindType = memberType;
+    if (llvm::isa<llvm::UnsetInit>(arg)) {
+      sub = "::ast::match::any";
+    } else if (const auto *childDag = llvm::dyn_cast<llvm::DagInit>(arg)) {
+      if (!isASTMember)
+        llvm::PrintFatalError(
+            pattern->getLoc(),
+            llvm::formatv("Member {0} of {1} is not an AST", memberName,
+                          model.ASTName));
+      auto childOpt =
+          createPatternMatcher(emitter, pattern, childDag, bindings);
+      if (!childOpt)
+        return std::nullopt;
+      sub = std::move(childOpt->Expr);
+      bindType = childOpt->KindType;
+    } else if (llvm::isa<llvm::IntInit, llvm::BitInit, llvm::StringInit>(
+                   arg)) {
+      if (isASTMember)
+        llvm::PrintFatalError(
+            pattern->getLoc(),
+            llvm::formatv("Member {0} of {1} is an AST and cannot match a "
+                          "value",
+                          memberName, model.ASTName));
+      std::string value;
+      llvm::raw_string_ostream valueStream(value);
+      if (const auto *stringInit = llvm::dyn_cast<llvm::StringInit>(arg)) {
+        valueStream << '"';
+        llvm::printEscapedString(stringInit->getValue(), valueStream);
+        valueStream << '"';
+      } else {
+        valueStream << arg->getAsString();
+      }
+      sub = llvm::formatv("::ast::match::eq<{0}>({1})", memberType->toString(),
+                          valueStream.str())
+                .str();
+    } else {
+      llvm::PrintFatalError(
+          pattern->getLoc(),
+          llvm::formatv("Unsupported pattern argument: {0}",
+                        arg->getAsString()));
+    }
+
+    llvm::StringRef bindName = dag->getArgNameStr(idx);
+    if (!bindName.empty()) {
+      if (llvm::any_of(bindings, [&](const cxx::DeclPair &binding) {
+            return binding.first == bindName;
+          }))
+        llvm::PrintFatalError(
+            pattern->getLoc(),
+            llvm::formatv("Duplicate pattern binding: {0}", bindName));
+      bindings.emplace_back(
+          bindName.str(),
+          cxx::ReferenceType::create(emitter->getContext(), bindType));
+      sub = llvm::formatv("::ast::match::bind({0}, {1})", bindName, sub).str();
+    }
+    ss << sub;
+  }
+  ss << ')';
+
+  return PatternMatcher{
+      .Expr = ss.str(),
+      .KindType = cxx::RawType::create(emitter->getContext(), kindName, {}),
+  };
+}
+
+std::unique_ptr<PatternModel> PatternModel::create(TableGenEmitter *emitter,
+                                                   llvm::Record *record) {
+  assert(record->isSubClassOf("Pattern"));
+  llvm::StringRef namespaceName = record->getValueAsString("namespace");
+  llvm::DagInit *pattern = record->getValueAsDag("pattern");
+
+  llvm::SmallVector<cxx::DeclPair> bindings;
+  auto matcherOpt = createPatternMatcher(emitter, record, pattern, bindings);
+  if (!matcherOpt)
+    return nullptr;
+
+  /// matcher function
+  auto *matcherFunction = cxx::Function::create(
+      emitter->getContext(), std::nullopt, cxx::Function::Access::Inline,
+      cxx::RawType::create(emitter->getContext(), "auto", {}), std::nullopt,
+      record->getName(), bindings,
+      cxx::BodyCode{"return " + matcherOpt->Expr + ";"});
+
+  return std::unique_ptr<PatternModel>(
+      new PatternModel(record->getName(), namespaceName, matcherFunction));
 }
 
 } // namespace ast::tblgen
@@ -21,8 +21,16 @@ struct DataModel {
 
   llvm::SmallVector<llvm::StringRef> TreeMemberParamNames;
   llvm::SmallVector<TableGenEmitter::TypePair> TreeMemberTypePairs;
+  llvm::SmallVector<TableGenEmitter::ChildKind> TreeMemberChildKinds;
+  /// Qualified names of the kinds an ASTTypeOf member may hold, or
+  /// std::nullopt for other members.
+  llvm::SmallVector<std::optional<llvm::SmallVector<std::string>>>
+      TreeMemberKindNames;
   llvm::SmallVector<llvm::StringRef> TagParamNames;
   llvm::SmallVector<TableGenEmitter::TypePair> TagTypePairs;
+  /// Qualified names of the ASTs that may occur below this one, or
+  /// std::nullopt if any AST may.
+  std::optional<llvm::SmallVector<std::string>> DescendantKindNames;
 
   static std::optional<DataModel> create(TableGenEmitter *emitter,
                                          llvm::Record *record);
@@ -80,6 +88,9 @@ public:
     return astImplConstructor;
   }
   cxx::Function *getASTCreateFunction() const { return astCreateFunction; }
+  cxx::Function *getDescendantKindsFunction() const {
+    return descendantKindsFunction;
+  }
 
   void print(llvm::raw_ostream &OS) const;
 
@@ -91,13 +102,15 @@ private:
               llvm::StringRef extraClassDefinition,
               cxx::Function *astImplCreateFunction,
               cxx::ClassConstructor *astImplConstructor,
-              cxx::Function *astCreateFunction)
+              cxx::Function *astCreateFunction,
+              cxx::Function *descendantKindsFunction)
       : className(className), classImplName(classImplName),
         namespaceName(namespaceName), description(description),
         extraClassDefinition(extraClassDefinition),
         astImplCreateFunction(astImplCreateFunction),
         astImplConstructor(astImplConstructor),
-        astCreateFunction(astCreateFunction) {}
+        astCreateFunction(astCreateFunction),
+        descendantKindsFunction(descendantKindsFunction) {}
 
   std::string className;
   std::string classImplName;
@@ -107,6 +120,28 @@ private:
   cxx::Function *astImplCreateFunction;
   cxx::ClassConstructor *astImplConstructor;
   cxx::Function *astCreateFunction;
+  cxx::Function *descendantKindsFunction;
+};
+
+class PatternModel {
+public:
+  llvm::StringRef getName() const { return name; }
+  llvm::StringRef getNamespaceName() const { return namespaceName; }
+
+  cxx::Function *getMatcherFunction() const { return matcherFunction; }
+
+  static std::unique_ptr<PatternModel> create(TableGenEmitter *emitter,
+                                              llvm::Record *record);
+
+private:
+  PatternModel(llvm::StringRef name, llvm::StringRef namespaceName,
+               cxx::Function *matcherFunction)
+      : name(name), namespaceName(namespaceName),
+        matcherFunction(matcherFunction) {}
+
+  std::string name;
+  std::string namespaceName;
+  cxx::Function *matcherFunction;
 };
 
 } // namespace ast::tblgen
@@ -6,12 +6,15 @@ namespace ast::tblgen {
 
 extern bool ASTDeclGenMain(llvm::raw_ostream &OS, llvm::RecordKeeper &Records);
 extern bool ASTDefGenMain(llvm::raw_ostream &OS, llvm::RecordKeeper &Records);
+extern bool ASTPatternGenMain(llvm::raw_ostream &OS,
+                              llvm::RecordKeeper &Records);
 
 } // namespace ast::tblgen
 
 enum class ASTTableGenBackend {
   ASTDeclGen,
   ASTDefGen,
+  ASTPatternGen,
 };
 
 static llvm::cl::opt<ASTTableGenBackend> Backend(
@@ -19,7 +22,10 @@ static llvm::cl::opt<ASTTableGenBackend> Backend(
     llvm::cl::values(clEnumValN(ASTTableGenBackend::ASTDeclGen, "ast-decl-gen",
                                 "Generate AST declarations"),
                      clEnumValN(ASTTableGenBackend::ASTDefGen, "ast-def-gen",
-                                "Generate AST definitions")),
+                                "Generate AST definitions"),
+                     clEnumValN(ASTTableGenBackend::ASTPatternGen,
+                                "ast-pattern-gen",
+                                "Generate AST pattern matchers")),
     llvm::cl::init(ASTTableGenBackend::ASTDeclGen), llvm::cl::Required);
 
 int main(int argc, char **argv) {
@@ -34,6 +40,9 @@ int main(int argc, char **argv) {
   case ASTTableGenBackend::ASTDefGen:
     MainFn = ast::tblgen::ASTDefGenMain;
     break;
+  case ASTTableGenBackend::ASTPatternGen:
+    MainFn = ast::tblgen::ASTPatternGenMain;
+    break;
   };
 
   return llvm::TableGenMain(argv[0], MainFn);